@@ -0,0 +1,5 @@
+//
+// This module stands for SDKDDKVer.h of the SDK, which has no counterpart on
+// other than Windows.
+//
+#pragma once
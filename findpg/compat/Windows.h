@@ -0,0 +1,259 @@
+//
+// This module declears the subset of Windows types, macros and functions used
+// by the scan core so that it can be built with GCC or Clang on other than
+// Windows. It is found instead of the header of the SDK only by the CMake
+// build on those platforms.
+//
+#pragma once
+
+// C/C++ standard headers
+// Headers of libstdc++ using __in as an identifier are included before it is
+// defined as an annotation below, so that they may be included in any order
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <string>
+#include <tuple>
+#include <utility>
+
+// Other external headers
+#include <time.h>
+#include <x86intrin.h>
+
+// Windows headers
+// Original headers
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+#define UNREFERENCED_PARAMETER(P)   (void)(P)
+#define C_ASSERT(e)                 static_assert(e, #e)
+#define _countof(a)                 (sizeof(a) / sizeof((a)[0]))
+#define FIELD_OFFSET(type, field)   offsetof(type, field)
+#define SUCCEEDED(hr)               (static_cast<HRESULT>(hr) >= 0)
+#define FAILED(hr)                  (static_cast<HRESULT>(hr) < 0)
+
+// Annotations
+#define __in
+#define __in_opt
+#define __out
+#define __out_opt
+#define __inout
+#define __out_ecount(size)
+#define __out_ecount_opt(size)
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+#define CALLBACK
+#define WINAPI
+
+#define TRUE    1
+#define FALSE   0
+
+#define MAXULONG    0xffffffffu
+
+#define S_OK            static_cast<HRESULT>(0x00000000)
+#define S_FALSE         static_cast<HRESULT>(0x00000001)
+#define E_FAIL          static_cast<HRESULT>(0x80004005)
+#define E_INVALIDARG    static_cast<HRESULT>(0x80070057)
+#define E_OUTOFMEMORY   static_cast<HRESULT>(0x8007000E)
+
+#define _TRUNCATE   (static_cast<size_t>(-1))
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// ULONG and LONG are 32 bits on Windows regardless of the data model, and
+// 64-bit types are long long as they are with MSVC
+typedef unsigned char UCHAR;
+typedef unsigned short USHORT;
+typedef std::int32_t LONG;
+typedef std::uint32_t ULONG;
+typedef long long LONG64;
+typedef unsigned long long ULONG64;
+typedef long long LONGLONG;
+typedef unsigned long long ULONGLONG;
+typedef std::size_t SIZE_T;
+typedef int BOOL;
+typedef LONG HRESULT;
+
+typedef union _LARGE_INTEGER
+{
+    struct
+    {
+        ULONG LowPart;
+        LONG HighPart;
+    };
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+// The performance counter is the monotonic clock in nanoseconds
+inline BOOL QueryPerformanceFrequency(
+    __out LARGE_INTEGER* Frequency)
+{
+    Frequency->QuadPart = 1000000000;
+    return TRUE;
+}
+
+
+inline BOOL QueryPerformanceCounter(
+    __out LARGE_INTEGER* Counter)
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    Counter->QuadPart = now.tv_sec * 1000000000ll + now.tv_nsec;
+    return TRUE;
+}
+
+
+inline ULONG64 GetTickCount64()
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000ull + now.tv_nsec / 1000000;
+}
+
+
+inline unsigned char _BitScanForward64(
+    __out unsigned long* Index,
+    __in ULONG64 Mask)
+{
+    if (!Mask)
+    {
+        return 0;
+    }
+    *Index = __builtin_ctzll(Mask);
+    return 1;
+}
+
+
+inline unsigned char _BitScanForward(
+    __out unsigned long* Index,
+    __in ULONG Mask)
+{
+    if (!Mask)
+    {
+        return 0;
+    }
+    *Index = __builtin_ctz(Mask);
+    return 1;
+}
+
+
+inline ULONG64 _rotl64(
+    __in ULONG64 Value,
+    __in int Shift)
+{
+    Shift &= 63;
+    return (Shift) ? (Value << Shift) | (Value >> (64 - Shift)) : Value;
+}
+
+
+inline ULONG64 _byteswap_uint64(
+    __in ULONG64 Value)
+{
+    return __builtin_bswap64(Value);
+}
+
+
+inline ULONG64 _strtoui64(
+    __in const char* String,
+    __out_opt char** End,
+    __in int Base)
+{
+    return std::strtoull(String, End, Base);
+}
+
+
+// Formats a string in the same way as MSVC. Size prefixes of MSVC ("%I64u"
+// and "%Iu") used in messages of the scan core are converted into those of C99
+// ("%llu" and "%zu"). The converted format is built on the stack so that
+// messages are displayed without heap allocations as they are with MSVC.
+inline int _vsnprintf_s(
+    __out char* Buffer,
+    __in size_t BufferSize,
+    __in size_t /*MaxCount*/,
+    __in const char* Format,
+    __in va_list Args)
+{
+    // Room for two more characters of a conversion and the terminator is
+    // always left. A longer format is truncated.
+    char format[1024];
+    size_t length = 0;
+    for (auto p = Format; *p && length + 3 < sizeof(format); ++p)
+    {
+        format[length++] = *p;
+        if (*p != '%')
+        {
+            continue;
+        }
+        while (p[1] && std::strchr("-+ #0123456789.", p[1]) &&
+            length + 3 < sizeof(format))
+        {
+            format[length++] = *++p;
+        }
+        if (p[1] == 'I' && p[2] == '6' && p[3] == '4')
+        {
+            format[length++] = 'l';
+            format[length++] = 'l';
+            p += 3;
+        }
+        else if (p[1] == 'I')
+        {
+            format[length++] = 'z';
+            p += 1;
+        }
+        else if (p[1] == '%')
+        {
+            format[length++] = *++p;
+        }
+    }
+    format[length] = '\0';
+    const auto result = std::vsnprintf(Buffer, BufferSize, format, Args);
+    return (result < 0 || static_cast<size_t>(result) >= BufferSize)
+        ? -1 : result;
+}
+
+
+template <size_t Size>
+int _vsnprintf_s(
+    __out char (&Buffer)[Size],
+    __in size_t MaxCount,
+    __in const char* Format,
+    __in va_list Args)
+{
+    return _vsnprintf_s(Buffer, Size, MaxCount, Format, Args);
+}
+
@@ -0,0 +1,12 @@
+//
+// This module stands for intrin.h of MSVC. Intrinsics used by the scan core
+// are declared by Windows.h of this directory.
+//
+#pragma once
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
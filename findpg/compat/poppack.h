@@ -0,0 +1,5 @@
+//
+// This module stands for poppack.h of the SDK and restores the packing
+// changed by pshpack1.h.
+//
+#pragma pack(pop)
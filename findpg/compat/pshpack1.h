@@ -0,0 +1,5 @@
+//
+// This module stands for pshpack1.h of the SDK and packs structures declared
+// after it on 1-byte boundaries until poppack.h is included.
+//
+#pragma pack(push, 1)
@@ -0,0 +1,300 @@
+//
+// This module declears and implements a class responsible for classifying
+// candidate regions with a pipeline of predicate stages.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "ScanProvider.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Runs predicate stages against a candidate until one of them rejects it.
+//
+// Each stage has a measured cost and rejection rate, and stages are ordered by
+// cost / rejection rate so that cheap stages rejecting most candidates run
+// first, which minimizes the expected cost per candidate when stages are
+// independent. The order is recomputed from live statistics every
+// REORDER_INTERVAL candidates. The cost is measured only for every
+// TIMING_INTERVAL candidates since reading the performance counter costs as
+// much as some of the stages. A stage may depend on another stage (for
+// example, content checks depend on the stage reading the contents) and never
+// runs before it.
+template <typename CandidateType>
+class CandidatePipeline
+{
+public:
+    typedef std::function<bool(CandidateType&)> Predicate;
+
+    enum class StageKind
+    {
+        CpuOnly,        // Examines data already in hand
+        RequiresRead,   // Reads memory of the target
+    };
+
+    static const SIZE_T NO_DEPENDENCY = static_cast<SIZE_T>(-1);
+
+    CandidatePipeline();
+
+    // Adds a stage and returns its index that can be used as DependsOn of
+    // subsequent stages
+    SIZE_T AddStage(
+        __in const char* Name,
+        __in StageKind Kind,
+        __in Predicate Pred,
+        __in SIZE_T DependsOn = NO_DEPENDENCY);
+
+    // Returns true when all stages accepted the candidate
+    bool Run(
+        __inout CandidateType& Candidate);
+
+    void DisplayStatistics(
+        __in ScanProvider& Provider) const;
+
+private:
+    struct Stage
+    {
+        const char* Name;
+        StageKind Kind;
+        Predicate Pred;
+        SIZE_T DependsOn;
+        std::uint64_t NumberOfEvaluations;
+        std::uint64_t NumberOfRejections;
+        std::uint64_t NumberOfTimedEvaluations;
+        std::uint64_t Ticks;    // Spent by timed evaluations
+    };
+
+    void Reorder();
+
+    double GetAverageCost(
+        __in const Stage& CurrentStage) const;
+
+    double GetRejectionRate(
+        __in const Stage& CurrentStage) const;
+
+    // The number of candidates between two reorders
+    static const std::uint64_t REORDER_INTERVAL = 256;
+
+    // Stages are timed for one in this number of candidates
+    static const std::uint64_t TIMING_INTERVAL = 16;
+
+    // The number of evaluations before measured statistics are trusted
+    static const std::uint64_t MINIMUM_SAMPLES = 32;
+    static const std::uint64_t MINIMUM_TIMED_SAMPLES = 8;
+
+    std::vector<Stage> m_Stages;
+    std::vector<SIZE_T> m_Order;
+    std::vector<bool> m_Placed;     // Reused by Reorder()
+    std::uint64_t m_NumberOfRuns;
+    double m_TicksPerMicrosecond;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+template <typename CandidateType>
+CandidatePipeline<CandidateType>::CandidatePipeline()
+    : m_NumberOfRuns(0)
+    , m_TicksPerMicrosecond(1.0)
+{
+    LARGE_INTEGER frequency = {};
+    if (QueryPerformanceFrequency(&frequency))
+    {
+        m_TicksPerMicrosecond = frequency.QuadPart / 1000000.0;
+    }
+}
+
+
+template <typename CandidateType>
+SIZE_T CandidatePipeline<CandidateType>::AddStage(
+    __in const char* Name,
+    __in StageKind Kind,
+    __in Predicate Pred,
+    __in SIZE_T DependsOn)
+{
+    const Stage stage = { Name, Kind, Pred, DependsOn, 0, 0, 0, 0, };
+    m_Stages.push_back(stage);
+    Reorder();
+    return m_Stages.size() - 1;
+}
+
+
+template <typename CandidateType>
+bool CandidatePipeline<CandidateType>::Run(
+    __inout CandidateType& Candidate)
+{
+    if ((++m_NumberOfRuns % REORDER_INTERVAL) == 0)
+    {
+        Reorder();
+    }
+
+    const auto isTimed = (m_NumberOfRuns % TIMING_INTERVAL) == 0;
+    for (const auto index : m_Order)
+    {
+        auto& stage = m_Stages[index];
+        auto accepted = false;
+        if (isTimed)
+        {
+            LARGE_INTEGER start = {}, end = {};
+            QueryPerformanceCounter(&start);
+            accepted = stage.Pred(Candidate);
+            QueryPerformanceCounter(&end);
+            stage.NumberOfTimedEvaluations++;
+            stage.Ticks += end.QuadPart - start.QuadPart;
+        }
+        else
+        {
+            accepted = stage.Pred(Candidate);
+        }
+        stage.NumberOfEvaluations++;
+        if (!accepted)
+        {
+            stage.NumberOfRejections++;
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Displays cost and benefit of each stage in the current order
+template <typename CandidateType>
+void CandidatePipeline<CandidateType>::DisplayStatistics(
+    __in ScanProvider& Provider) const
+{
+    Provider.Out("  %-16s %12s %12s %8s %12s\n",
+        "Stage", "Evaluated", "Rejected", "Reject%", "Cost(us)");
+    for (const auto index : m_Order)
+    {
+        const auto& stage = m_Stages[index];
+        Provider.Out("  %-16s %12I64u %12I64u %7.1f%% %12.3f\n",
+            stage.Name, stage.NumberOfEvaluations, stage.NumberOfRejections,
+            (stage.NumberOfEvaluations)
+                ? stage.NumberOfRejections * 100.0 / stage.NumberOfEvaluations
+                : 0.0,
+            (stage.NumberOfTimedEvaluations)
+                ? stage.Ticks / m_TicksPerMicrosecond
+                    / stage.NumberOfTimedEvaluations
+                : 0.0);
+    }
+}
+
+
+// Orders stages by cost / rejection rate while respecting dependencies. The
+// stage with the lowest ratio among those whose dependency has already been
+// placed is placed next.
+template <typename CandidateType>
+void CandidatePipeline<CandidateType>::Reorder()
+{
+    auto& placed = m_Placed;
+    placed.assign(m_Stages.size(), false);
+    m_Order.clear();
+    while (m_Order.size() < m_Stages.size())
+    {
+        auto best = NO_DEPENDENCY;
+        auto bestRatio = 0.0;
+        for (SIZE_T i = 0; i < m_Stages.size(); ++i)
+        {
+            const auto& stage = m_Stages[i];
+            if (placed[i] ||
+                (stage.DependsOn != NO_DEPENDENCY && !placed[stage.DependsOn]))
+            {
+                continue;
+            }
+            const auto ratio = GetAverageCost(stage) / GetRejectionRate(stage);
+            if (best == NO_DEPENDENCY || ratio < bestRatio)
+            {
+                best = i;
+                bestRatio = ratio;
+            }
+        }
+        if (best == NO_DEPENDENCY)
+        {
+            // Unsatisfiable dependencies. Keep remaining stages as added.
+            for (SIZE_T i = 0; i < m_Stages.size(); ++i)
+            {
+                if (!placed[i])
+                {
+                    placed[i] = true;
+                    m_Order.push_back(i);
+                }
+            }
+            break;
+        }
+        placed[best] = true;
+        m_Order.push_back(best);
+    }
+}
+
+
+// Returns the average cost of the stage in microseconds. Until enough timed
+// samples are collected, a rough estimate based on the kind of the stage is
+// used.
+template <typename CandidateType>
+double CandidatePipeline<CandidateType>::GetAverageCost(
+    __in const Stage& CurrentStage) const
+{
+    if (CurrentStage.NumberOfTimedEvaluations < MINIMUM_TIMED_SAMPLES)
+    {
+        return (CurrentStage.Kind == StageKind::CpuOnly) ? 0.1 : 100.0;
+    }
+    return CurrentStage.Ticks / m_TicksPerMicrosecond
+        / CurrentStage.NumberOfTimedEvaluations;
+}
+
+
+// Returns the rate of rejection of the stage. Until enough samples are
+// collected, one half is assumed.
+template <typename CandidateType>
+double CandidatePipeline<CandidateType>::GetRejectionRate(
+    __in const Stage& CurrentStage) const
+{
+    if (CurrentStage.NumberOfEvaluations < MINIMUM_SAMPLES)
+    {
+        return 0.5;
+    }
+    const auto rate = static_cast<double>(CurrentStage.NumberOfRejections)
+        / CurrentStage.NumberOfEvaluations;
+    return (rate < 0.001) ? 0.001 : rate;
+}
+
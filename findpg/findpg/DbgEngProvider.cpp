@@ -0,0 +1,175 @@
+//
+// This module implements a class responsible for giving the scanner access to
+// a target through the debugger engine.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "DbgEngProvider.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+DbgEngProvider::DbgEngProvider(
+    __in ExtExtension* Ext)
+    : m_Ext(Ext)
+{
+}
+
+
+bool DbgEngProvider::ReadVirtual(
+    __in ULONG64 Address,
+    __out void* Buffer,
+    __in ULONG Size,
+    __out_opt ULONG* ReadBytes)
+{
+    ULONG readBytes = 0;
+    auto result = m_Ext->m_Data->ReadVirtual(Address, Buffer, Size,
+        &readBytes);
+    if (ReadBytes)
+    {
+        *ReadBytes = readBytes;
+    }
+    return SUCCEEDED(result);
+}
+
+
+bool DbgEngProvider::ReadPointer(
+    __in ULONG64 Address,
+    __out ULONG64& Value)
+{
+    Value = 0;
+    auto result = m_Ext->m_Data->ReadPointersVirtual(1, Address, &Value);
+    return SUCCEEDED(result);
+}
+
+
+bool DbgEngProvider::GetNextDifferentlyValidOffset(
+    __in ULONG64 Address,
+    __out ULONG64& NextAddress)
+{
+    NextAddress = 0;
+    auto result = m_Ext->m_Data4->GetNextDifferentlyValidOffsetVirtual(
+        Address, &NextAddress);
+    return SUCCEEDED(result) && NextAddress > Address;
+}
+
+
+bool DbgEngProvider::GetSymbolOffset(
+    __in const char* Symbol,
+    __out ULONG64& Offset)
+{
+    auto result = m_Ext->m_Symbols->GetOffsetByName(Symbol, &Offset);
+    return SUCCEEDED(result);
+}
+
+
+bool DbgEngProvider::GetTypeSize(
+    __in const char* Type,
+    __out ULONG& Size)
+{
+    ULONG typeId = 0;
+    ULONG64 module = 0;
+    auto result = m_Ext->m_Symbols->GetSymbolTypeId(Type, &typeId, &module);
+    if (!SUCCEEDED(result))
+    {
+        return false;
+    }
+    result = m_Ext->m_Symbols->GetTypeSize(module, typeId, &Size);
+    return SUCCEEDED(result);
+}
+
+
+bool DbgEngProvider::GetFieldOffset(
+    __in const char* Type,
+    __in const char* Field,
+    __out ULONG& Offset)
+{
+    ULONG typeId = 0;
+    ULONG64 module = 0;
+    auto result = m_Ext->m_Symbols->GetSymbolTypeId(Type, &typeId, &module);
+    if (!SUCCEEDED(result))
+    {
+        return false;
+    }
+    result = m_Ext->m_Symbols->GetFieldOffset(module, typeId, Field, &Offset);
+    return SUCCEEDED(result);
+}
+
+
+bool DbgEngProvider::GetModuleIdentity(
+    __in const char* Module,
+    __out ULONG64& Base,
+    __out ULONG& TimeDateStamp,
+    __out ULONG& SizeOfImage)
+{
+    Base = 0;
+    TimeDateStamp = 0;
+    SizeOfImage = 0;
+    auto result = m_Ext->m_Symbols->GetModuleByModuleName(Module, 0, nullptr,
+        &Base);
+    if (!SUCCEEDED(result))
+    {
+        return false;
+    }
+    DEBUG_MODULE_PARAMETERS parameters = {};
+    result = m_Ext->m_Symbols->GetModuleParameters(1, &Base, 0, &parameters);
+    if (!SUCCEEDED(result))
+    {
+        return false;
+    }
+    TimeDateStamp = parameters.TimeDateStamp;
+    SizeOfImage = parameters.Size;
+    return true;
+}
+
+
+void DbgEngProvider::Write(
+    __in const char* Text)
+{
+    m_Ext->Out("%s", Text);
+}
+
+
+void DbgEngProvider::WriteError(
+    __in const char* Text)
+{
+    m_Ext->Err("%s", Text);
+}
+
@@ -0,0 +1,99 @@
+//
+// This module declears a class responsible for giving the scanner access to
+// a target through the debugger engine.
+//
+#pragma once
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+#include <engextcpp.hpp>
+
+// Original headers
+#include "ScanProvider.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+class DbgEngProvider : public ScanProvider
+{
+public:
+    DbgEngProvider(
+        __in ExtExtension* Ext);
+
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes);
+
+    virtual bool ReadPointer(
+        __in ULONG64 Address,
+        __out ULONG64& Value);
+
+    virtual bool GetNextDifferentlyValidOffset(
+        __in ULONG64 Address,
+        __out ULONG64& NextAddress);
+
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset);
+
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size);
+
+    virtual bool GetFieldOffset(
+        __in const char* Type,
+        __in const char* Field,
+        __out ULONG& Offset);
+
+    virtual bool GetModuleIdentity(
+        __in const char* Module,
+        __out ULONG64& Base,
+        __out ULONG& TimeDateStamp,
+        __out ULONG& SizeOfImage);
+
+    virtual void Write(
+        __in const char* Text);
+
+    virtual void WriteError(
+        __in const char* Text);
+
+private:
+    ExtExtension* m_Ext;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
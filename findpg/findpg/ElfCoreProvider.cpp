@@ -0,0 +1,277 @@
+//
+// This module implements a class responsible for giving the scanner access to
+// a memory dump of a virtual machine in the ELF core format.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "ElfCoreProvider.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+static const ULONG ELF_MAGIC = 0x464c457f;     // "\x7fELF"
+static const UCHAR ELF_CLASS64 = 2;
+static const UCHAR ELF_DATA2LSB = 1;
+static const ULONG ELF_PT_LOAD = 1;
+static const ULONG ELF_PT_NOTE = 4;
+
+// Offset of cr[3] in QEMUCPUState: version and size (8), 16 general purpose
+// registers (128), rip and rflags (16), 10 segments of 24 bytes (240) and
+// cr[0] to cr[2] (24). cr[4] follows it.
+static const SIZE_T QEMU_CPU_STATE_CR3_OFFSET = 416;
+static const SIZE_T QEMU_CPU_STATE_CR4_OFFSET = 424;
+static const SIZE_T QEMU_CPU_STATE_RIP_OFFSET = 136;
+
+// CR4 bit enabling 5-level paging
+static const ULONG64 CR4_LA57 = 1ull << 12;
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+#include <pshpack1.h>
+struct Elf64Header
+{
+    ULONG Magic;
+    UCHAR Class;
+    UCHAR Data;
+    UCHAR Version;
+    UCHAR Padding[9];
+    USHORT Type;
+    USHORT Machine;
+    ULONG Version2;
+    ULONG64 Entry;
+    ULONG64 ProgramHeaderOffset;
+    ULONG64 SectionHeaderOffset;
+    ULONG Flags;
+    USHORT HeaderSize;
+    USHORT ProgramHeaderEntrySize;
+    USHORT NumberOfProgramHeaders;
+    USHORT SectionHeaderEntrySize;
+    USHORT NumberOfSectionHeaders;
+    USHORT SectionNameIndex;
+};
+C_ASSERT(sizeof(Elf64Header) == 64);
+
+
+struct Elf64ProgramHeader
+{
+    ULONG Type;
+    ULONG Flags;
+    ULONG64 Offset;
+    ULONG64 VirtualAddress;
+    ULONG64 PhysicalAddress;
+    ULONG64 FileSize;
+    ULONG64 MemorySize;
+    ULONG64 Alignment;
+};
+C_ASSERT(sizeof(Elf64ProgramHeader) == 56);
+
+
+struct Elf64NoteHeader
+{
+    ULONG NameSize;
+    ULONG DescriptionSize;
+    ULONG Type;
+};
+#include <poppack.h>
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+ElfCoreProvider::ElfCoreProvider(
+    __in ScanProvider& Output,
+    __in const std::string& Path,
+    __in ULONG64 MaximumMappedBytes)
+    : GuestMemoryProvider(Output)
+    , m_File(Path, false, MaximumMappedBytes)
+{
+    Parse();
+}
+
+
+// Builds the index of PT_LOAD segments and takes CR3 from the notes
+void ElfCoreProvider::Parse()
+{
+    // Headers and notes are copied since only a part of the file is mapped
+    // at a time
+    const auto fileSize = m_File.GetSize();
+    Elf64Header header = {};
+    if (!m_File.Read(0, &header, sizeof(header)))
+    {
+        throw std::runtime_error("The file is not an ELF core file.");
+    }
+    if (header.Magic != ELF_MAGIC ||
+        header.Class != ELF_CLASS64 ||
+        header.Data != ELF_DATA2LSB ||
+        header.ProgramHeaderEntrySize != sizeof(Elf64ProgramHeader) ||
+        header.ProgramHeaderOffset + header.NumberOfProgramHeaders
+            * sizeof(Elf64ProgramHeader) > fileSize)
+    {
+        throw std::runtime_error("The file is not a 64bit ELF core file.");
+    }
+
+    std::vector<Elf64ProgramHeader> programHeaders(
+        header.NumberOfProgramHeaders);
+    if (!m_File.Read(header.ProgramHeaderOffset, programHeaders.data(),
+        programHeaders.size() * sizeof(Elf64ProgramHeader)))
+    {
+        throw std::runtime_error("The file is not a 64bit ELF core file.");
+    }
+    ULONG64 fallbackCr3 = 0;
+    std::vector<std::uint8_t> notes;
+    for (const auto& programHeader : programHeaders)
+    {
+        if (programHeader.Offset > fileSize ||
+            programHeader.FileSize > fileSize - programHeader.Offset)
+        {
+            continue;
+        }
+
+        if (programHeader.Type == ELF_PT_LOAD && programHeader.FileSize)
+        {
+            const Segment segment = {
+                programHeader.PhysicalAddress,
+                programHeader.FileSize,
+                programHeader.Offset,
+            };
+            m_Segments.push_back(segment);
+            continue;
+        }
+        if (programHeader.Type != ELF_PT_NOTE)
+        {
+            continue;
+        }
+
+        // Walk notes and pick CR3 of a vCPU whose RIP is in kernel address
+        // space, since a vCPU in user mode may use a CR3 that maps little of
+        // the kernel address space
+        notes.resize(static_cast<SIZE_T>(programHeader.FileSize));
+        if (!m_File.Read(programHeader.Offset, notes.data(), notes.size()))
+        {
+            continue;
+        }
+        const std::uint8_t* note = notes.data();
+        const auto end = note + notes.size();
+        while (note + sizeof(Elf64NoteHeader) <= end)
+        {
+            const auto noteHeader = reinterpret_cast<const Elf64NoteHeader*>(
+                note);
+            const auto name = reinterpret_cast<const char*>(
+                note + sizeof(Elf64NoteHeader));
+            const auto description = note + sizeof(Elf64NoteHeader)
+                + ((noteHeader->NameSize + 3) & ~3u);
+            const auto next = description
+                + ((noteHeader->DescriptionSize + 3) & ~3u);
+            if (next > end)
+            {
+                break;
+            }
+            if (noteHeader->NameSize == 5 && memcmp(name, "QEMU", 5) == 0 &&
+                noteHeader->DescriptionSize >= QEMU_CPU_STATE_CR4_OFFSET
+                    + sizeof(ULONG64))
+            {
+                const auto cr3 = *reinterpret_cast<const ULONG64*>(
+                    description + QEMU_CPU_STATE_CR3_OFFSET);
+                const auto cr4 = *reinterpret_cast<const ULONG64*>(
+                    description + QEMU_CPU_STATE_CR4_OFFSET);
+                const auto rip = *reinterpret_cast<const ULONG64*>(
+                    description + QEMU_CPU_STATE_RIP_OFFSET);
+                if (!fallbackCr3)
+                {
+                    fallbackCr3 = cr3;
+                }
+                if (cr4 & CR4_LA57)
+                {
+                    m_NumberOfLevels = 5;
+                }
+                if (!m_DirectoryTableBase && (rip >> 63))
+                {
+                    m_DirectoryTableBase = cr3;
+                }
+            }
+            note = next;
+        }
+    }
+
+    if (!m_DirectoryTableBase)
+    {
+        m_DirectoryTableBase = fallbackCr3;
+    }
+    if (!m_DirectoryTableBase)
+    {
+        throw std::runtime_error("The ELF core file has no QEMU CPU state.");
+    }
+    if (m_Segments.empty())
+    {
+        throw std::runtime_error("The ELF core file has no memory.");
+    }
+    std::sort(m_Segments.begin(), m_Segments.end(), [](
+        const Segment& Lhs,
+        const Segment& Rhs)
+    {
+        return Lhs.PhysicalAddress < Rhs.PhysicalAddress;
+    });
+}
+
+
+// Looks up the segment containing the guest physical address
+const std::uint8_t* ElfCoreProvider::GetPhysical(
+    __in ULONG64 PhysicalAddress,
+    __out ULONG64& Available)
+{
+    Available = 0;
+    auto it = std::upper_bound(m_Segments.begin(), m_Segments.end(),
+        PhysicalAddress, [](ULONG64 Address, const Segment& Rhs)
+    {
+        return Address < Rhs.PhysicalAddress;
+    });
+    if (it == m_Segments.begin())
+    {
+        return nullptr;
+    }
+    --it;
+    const auto offset = PhysicalAddress - it->PhysicalAddress;
+    if (offset >= it->Size)
+    {
+        return nullptr;
+    }
+    const auto data = m_File.Map(it->FileOffset + offset, Available);
+    if (data && Available > it->Size - offset)
+    {
+        Available = it->Size - offset;
+    }
+    return data;
+}
+
@@ -0,0 +1,91 @@
+//
+// This module declears a class responsible for giving the scanner access to
+// a memory dump of a virtual machine in the ELF core format.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "GuestMemoryProvider.h"
+#include "MappedFile.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Reads guest memory from an ELF core written by QEMU dump-guest-memory or
+// virsh dump --memory-only. The file is mapped through a bounded number of
+// windows, and guest physical addresses are looked up in PT_LOAD segments
+// sorted by address. CR3 is taken from the QEMU notes of a vCPU running in
+// kernel mode.
+class ElfCoreProvider : public GuestMemoryProvider
+{
+public:
+    // Throws std::runtime_error when the file cannot be used
+    ElfCoreProvider(
+        __in ScanProvider& Output,
+        __in const std::string& Path,
+        __in ULONG64 MaximumMappedBytes);
+
+    SIZE_T GetNumberOfSegments() const { return m_Segments.size(); }
+    const MappedFile& GetFile() const { return m_File; }
+
+protected:
+    virtual const std::uint8_t* GetPhysical(
+        __in ULONG64 PhysicalAddress,
+        __out ULONG64& Available);
+
+private:
+    struct Segment
+    {
+        ULONG64 PhysicalAddress;
+        ULONG64 Size;
+        ULONG64 FileOffset;
+    };
+
+    void Parse();
+
+    MappedFile m_File;
+    std::vector<Segment> m_Segments;    // Sorted by PhysicalAddress
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
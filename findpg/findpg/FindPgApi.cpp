@@ -0,0 +1,445 @@
+//
+// This module implements a C API to find PatchGuard pages outside of the
+// debugger.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "FindPgApi.h"
+#include "Scanner.h"
+#include "NegativeReadCache.h"
+#include "TraceReplayer.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+namespace {
+
+// Gives the scanner access to a target through callbacks of a caller
+class CallbackProvider : public ScanProvider
+{
+public:
+    explicit CallbackProvider(
+        __in const FINDPG_PROVIDER& Callbacks)
+        : m_Callbacks(Callbacks)
+    {
+    }
+
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes)
+    {
+        ULONG readBytes = 0;
+        const auto result = m_Callbacks.ReadVirtual(m_Callbacks.Context,
+            Address, Buffer, Size, &readBytes);
+        if (ReadBytes)
+        {
+            *ReadBytes = readBytes;
+        }
+        return result && readBytes != 0;
+    }
+
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset)
+    {
+        return m_Callbacks.GetSymbolOffset(m_Callbacks.Context, Symbol,
+            &Offset) != FALSE;
+    }
+
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size)
+    {
+        if (!m_Callbacks.GetTypeSize)
+        {
+            return false;
+        }
+        return m_Callbacks.GetTypeSize(m_Callbacks.Context, Type, &Size)
+            != FALSE;
+    }
+
+    virtual bool GetFieldOffset(
+        __in const char* Type,
+        __in const char* Field,
+        __out ULONG& Offset)
+    {
+        // Added after the first version
+        if (m_Callbacks.Size < FIELD_OFFSET(FINDPG_PROVIDER, GetFieldOffset)
+            + sizeof(m_Callbacks.GetFieldOffset) ||
+            !m_Callbacks.GetFieldOffset)
+        {
+            Offset = 0;
+            return false;
+        }
+        return m_Callbacks.GetFieldOffset(m_Callbacks.Context, Type, Field,
+            &Offset) != FALSE;
+    }
+
+    virtual void Write(
+        __in const char* Text)
+    {
+        if (m_Callbacks.Output)
+        {
+            m_Callbacks.Output(m_Callbacks.Context, Text);
+        }
+    }
+
+private:
+    const FINDPG_PROVIDER& m_Callbacks;
+};
+
+
+// Gives TraceReplayer a place to display messages through a callback of a
+// caller, which is optional. It has no target.
+class CallbackOutput : public ScanProvider
+{
+public:
+    CallbackOutput(
+        __in_opt void (CALLBACK* Output)(void*, const char*),
+        __in_opt void* Context)
+        : m_Output(Output)
+        , m_Context(Context)
+    {
+    }
+
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes)
+    {
+        UNREFERENCED_PARAMETER(Address);
+        UNREFERENCED_PARAMETER(Buffer);
+        UNREFERENCED_PARAMETER(Size);
+        if (ReadBytes)
+        {
+            *ReadBytes = 0;
+        }
+        return false;
+    }
+
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset)
+    {
+        UNREFERENCED_PARAMETER(Symbol);
+        Offset = 0;
+        return false;
+    }
+
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size)
+    {
+        UNREFERENCED_PARAMETER(Type);
+        Size = 0;
+        return false;
+    }
+
+    virtual void Write(
+        __in const char* Text)
+    {
+        if (m_Output)
+        {
+            m_Output(m_Context, Text);
+        }
+    }
+
+private:
+    void (CALLBACK* m_Output)(void*, const char*);
+    void* m_Context;
+};
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+bool IsValidOptions(
+    __in const FINDPG_SCAN_OPTIONS* Options);
+
+std::vector<FINDPG_REGION> ScanTarget(
+    __in ScanProvider& Target,
+    __in const FINDPG_SCAN_OPTIONS& Options);
+
+HRESULT StoreRegions(
+    __in const std::vector<FINDPG_REGION>& Found,
+    __out_ecount_opt(Capacity) FINDPG_REGION* Regions,
+    __in ULONG Capacity,
+    __out ULONG* NumberOfRegions);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+HRESULT WINAPI FindPgScan(
+    __in const FINDPG_PROVIDER* Provider,
+    __in ULONG BudgetSeconds,
+    __out_ecount_opt(Capacity) FINDPG_REGION* Regions,
+    __in ULONG Capacity,
+    __out ULONG* NumberOfRegions)
+{
+    FINDPG_SCAN_OPTIONS options = {};
+    options.Size = sizeof(options);
+    options.BudgetSeconds = BudgetSeconds;
+    return FindPgScanEx(Provider, &options, Regions, Capacity,
+        NumberOfRegions);
+}
+
+
+HRESULT WINAPI FindPgScanEx(
+    __in const FINDPG_PROVIDER* Provider,
+    __in const FINDPG_SCAN_OPTIONS* Options,
+    __out_ecount_opt(Capacity) FINDPG_REGION* Regions,
+    __in ULONG Capacity,
+    __out ULONG* NumberOfRegions)
+{
+    if (!Provider || Provider->Size < FINDPG_PROVIDER_SIZE_V1 ||
+        !Provider->ReadVirtual || !Provider->GetSymbolOffset ||
+        !IsValidOptions(Options) || !NumberOfRegions || (!Regions && Capacity))
+    {
+        return E_INVALIDARG;
+    }
+    *NumberOfRegions = 0;
+
+    // Exceptions must not cross the C boundary
+    try
+    {
+        CallbackProvider callbacks(*Provider);
+        NegativeReadCache provider(callbacks);
+        return StoreRegions(ScanTarget(provider, *Options), Regions, Capacity,
+            NumberOfRegions);
+    }
+    catch (std::bad_alloc&)
+    {
+        return E_OUTOFMEMORY;
+    }
+    catch (std::exception& e)
+    {
+        if (Provider->Output)
+        {
+            Provider->Output(Provider->Context, e.what());
+        }
+        return E_FAIL;
+    }
+}
+
+
+HRESULT WINAPI FindPgReplay(
+    __in const char* Path,
+    __in const FINDPG_SCAN_OPTIONS* Options,
+    __in_opt void (CALLBACK* Output)(void*, const char*),
+    __in_opt void* Context,
+    __out_ecount_opt(Capacity) FINDPG_REGION* Regions,
+    __in ULONG Capacity,
+    __out ULONG* NumberOfRegions)
+{
+    if (!Path || !IsValidOptions(Options) || !NumberOfRegions ||
+        (!Regions && Capacity))
+    {
+        return E_INVALIDARG;
+    }
+    *NumberOfRegions = 0;
+
+    CallbackOutput output(Output, Context);
+    try
+    {
+        // Requests are made through the same cache as FindPgScanEx() and
+        // !findpg -record do, so that the same requests are found in the trace
+        TraceReplayer replayer(output, Path, false);
+        NegativeReadCache provider(replayer);
+        const auto found = ScanTarget(provider, *Options);
+        output.Out("%Iu requests were not found in the trace.\n",
+            replayer.GetNumberOfMisses());
+        return StoreRegions(found, Regions, Capacity, NumberOfRegions);
+    }
+    catch (std::bad_alloc&)
+    {
+        return E_OUTOFMEMORY;
+    }
+    catch (std::exception& e)
+    {
+        output.Write(e.what());
+        return E_FAIL;
+    }
+}
+
+HRESULT WINAPI FindPgGetPatternName(
+    __in ULONG Index,
+    __out_ecount(BufferSize) char* Buffer,
+    __in ULONG BufferSize)
+{
+    if (!Buffer || !BufferSize)
+    {
+        return E_INVALIDARG;
+    }
+    Buffer[0] = '\0';
+
+    try
+    {
+        PatternMatcher patterns;
+        patterns.AddDefaultPatterns();
+        if (Index >= patterns.GetNumberOfPatterns())
+        {
+            return E_INVALIDARG;
+        }
+        const auto& name = patterns.GetName(Index);
+        const auto length = (std::min)(name.size(),
+            static_cast<SIZE_T>(BufferSize - 1));
+        memcpy(Buffer, name.data(), length);
+        Buffer[length] = '\0';
+        return (length == name.size()) ? S_OK : S_FALSE;
+    }
+    catch (std::bad_alloc&)
+    {
+        return E_OUTOFMEMORY;
+    }
+}
+
+
+namespace {
+
+bool IsValidOptions(
+    __in const FINDPG_SCAN_OPTIONS* Options)
+{
+    return Options && Options->Size >= FINDPG_SCAN_OPTIONS_SIZE_V1;
+}
+
+
+// Scans the target and converts all regions found into FINDPG_REGION
+std::vector<FINDPG_REGION> ScanTarget(
+    __in ScanProvider& Target,
+    __in const FINDPG_SCAN_OPTIONS& Options)
+{
+    PageTableSnapshot pageTables;
+    PatternMatcher patterns;
+    ScanOptions options = {};
+    if (Options.BudgetSeconds)
+    {
+        options.Deadline = GetTickCount64() + Options.BudgetSeconds * 1000ull;
+    }
+    if (Options.Flags & FINDPG_SCAN_SEARCH_PATTERNS)
+    {
+        patterns.AddDefaultPatterns();
+        options.Patterns = &patterns;
+    }
+    Scanner scanner(Target, pageTables, options);
+    const auto found = scanner.Scan();
+
+    std::vector<FINDPG_REGION> regions;
+    for (const auto& n : found.BigPagePool)
+    {
+        const FINDPG_REGION region = {
+            FINDPG_REGION_BIG_PAGE_POOL,
+            std::get<0>(n).Key,
+            std::get<0>(n).Va,
+            std::get<0>(n).Size,
+            std::get<1>(n).NumberOfDistinctiveNumbers,
+            std::get<1>(n).Ramdomness,
+        };
+        regions.push_back(region);
+    }
+    for (const auto& n : found.Independent)
+    {
+        const FINDPG_REGION region = {
+            FINDPG_REGION_INDEPENDENT,
+            0,
+            std::get<0>(n),
+            std::get<1>(n),
+            std::get<2>(n).NumberOfDistinctiveNumbers,
+            std::get<2>(n).Ramdomness,
+        };
+        regions.push_back(region);
+    }
+    for (const auto& n : found.LargePage)
+    {
+        const FINDPG_REGION region = {
+            FINDPG_REGION_LARGE_PAGE,
+            0,
+            std::get<0>(n),
+            std::get<1>(n),
+            std::get<2>(n).NumberOfDistinctiveNumbers,
+            std::get<2>(n).Ramdomness,
+        };
+        regions.push_back(region);
+    }
+    for (const auto& n : found.Timer)
+    {
+        const FINDPG_REGION region = {
+            FINDPG_REGION_TIMER,
+            0,
+            std::get<0>(n),
+            std::get<1>(n),
+            std::get<2>(n).NumberOfDistinctiveNumbers,
+            std::get<2>(n).Ramdomness,
+        };
+        regions.push_back(region);
+    }
+    for (const auto& n : found.Decrypted)
+    {
+        const FINDPG_REGION region = {
+            FINDPG_REGION_DECRYPTED,
+            static_cast<ULONG>(std::get<1>(n)),
+            std::get<0>(n),
+            patterns.GetLength(std::get<1>(n)),
+            0,
+            0,
+        };
+        regions.push_back(region);
+    }
+    return regions;
+}
+
+
+// Copies as many regions as Regions can hold
+HRESULT StoreRegions(
+    __in const std::vector<FINDPG_REGION>& Found,
+    __out_ecount_opt(Capacity) FINDPG_REGION* Regions,
+    __in ULONG Capacity,
+    __out ULONG* NumberOfRegions)
+{
+    *NumberOfRegions = static_cast<ULONG>(Found.size());
+    const auto numberToCopy = (std::min)(Found.size(),
+        static_cast<SIZE_T>(Capacity));
+    std::copy(Found.begin(), Found.begin() + numberToCopy, Regions);
+    return (numberToCopy == Found.size()) ? S_OK : S_FALSE;
+}
+
+} // End of namespace {unnamed}
+
@@ -0,0 +1,199 @@
+//
+// This module declears a C API to find PatchGuard pages outside of the
+// debugger. A caller gives access to memory and symbols of a target through
+// callbacks, for example, to scan a memory image acquired by other tools.
+//
+#pragma once
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+#define FINDPG_REGION_BIG_PAGE_POOL     1
+#define FINDPG_REGION_INDEPENDENT       2
+#define FINDPG_REGION_LARGE_PAGE        3
+#define FINDPG_REGION_TIMER             4
+#define FINDPG_REGION_DECRYPTED         5
+
+// Flags of FINDPG_SCAN_OPTIONS
+#define FINDPG_SCAN_SEARCH_PATTERNS     0x00000001
+
+// The smallest Size of FINDPG_PROVIDER accepted, which ends at Output
+#define FINDPG_PROVIDER_SIZE_V1 \
+    (FIELD_OFFSET(FINDPG_PROVIDER, Output) + sizeof(void*))
+
+// The smallest Size of FINDPG_SCAN_OPTIONS accepted
+#define FINDPG_SCAN_OPTIONS_SIZE_V1 \
+    (FIELD_OFFSET(FINDPG_SCAN_OPTIONS, BudgetSeconds) + sizeof(ULONG))
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _FINDPG_PROVIDER
+{
+    // sizeof(FINDPG_PROVIDER) of the caller. Callbacks are only appended to
+    // this structure, and those beyond Size are treated as not given, so that
+    // callers built with an older version of this header keep working.
+    ULONG Size;
+
+    // Passed to all callbacks as is
+    void* Context;
+
+    // Reads virtual memory of the target and sets ReadBytes to the number of
+    // bytes read. Returns TRUE when at least the first byte is read.
+    BOOL (CALLBACK* ReadVirtual)(
+        __in void* Context,
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out ULONG* ReadBytes);
+
+    // Resolves an address of a symbol such as "nt!PoolBigPageTable"
+    BOOL (CALLBACK* GetSymbolOffset)(
+        __in void* Context,
+        __in const char* Symbol,
+        __out ULONG64* Offset);
+
+    // Returns a size of a type such as "nt!_POOL_TRACKER_BIG_PAGES".
+    // Optional.
+    BOOL (CALLBACK* GetTypeSize)(
+        __in void* Context,
+        __in const char* Type,
+        __out ULONG* Size);
+
+    // Receives progress and diagnostic messages. Optional.
+    void (CALLBACK* Output)(
+        __in void* Context,
+        __in const char* Text);
+
+    // Returns an offset of a field such as "TimerTable" of "nt!_KPRCB".
+    // Optional. Without it, timers are not analyzed, and regions of
+    // FINDPG_REGION_TIMER are never returned.
+    BOOL (CALLBACK* GetFieldOffset)(
+        __in void* Context,
+        __in const char* Type,
+        __in const char* Field,
+        __out ULONG* Offset);
+} FINDPG_PROVIDER;
+
+
+typedef struct _FINDPG_SCAN_OPTIONS
+{
+    // sizeof(FINDPG_SCAN_OPTIONS) of the caller. Fields are only appended to
+    // this structure in the same way as FINDPG_PROVIDER.
+    ULONG Size;
+
+    // FINDPG_SCAN_*. With FINDPG_SCAN_SEARCH_PATTERNS, every RWX page is read
+    // in full and searched for the built-in patterns of code and contexts
+    // that remain unencrypted, and matches are returned as regions of
+    // FINDPG_REGION_DECRYPTED. It makes Phase 2 slower.
+    ULONG Flags;
+
+    // Limits the time of analysis when it is not zero
+    ULONG BudgetSeconds;
+} FINDPG_SCAN_OPTIONS;
+
+
+typedef struct _FINDPG_REGION
+{
+    ULONG Type;     // FINDPG_REGION_*
+
+    // Pool tag when Type is FINDPG_REGION_BIG_PAGE_POOL, or the index of the
+    // matched pattern when Type is FINDPG_REGION_DECRYPTED
+    ULONG Key;
+
+    // The matched bytes when Type is FINDPG_REGION_DECRYPTED, whose
+    // randomness is not computed and is zero
+    ULONG64 Base;
+    ULONG64 Size;
+    ULONG NumberOfDistinctiveNumbers;
+    ULONG Randomness;
+} FINDPG_REGION;
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+// Finds PatchGuard pages of the target given by Provider. Up to Capacity
+// regions are stored in Regions, and NumberOfRegions receives the number of
+// regions found. Returns S_OK when all regions are stored, S_FALSE when
+// Regions was too small, or an error code. BudgetSeconds limits the time of
+// analysis when it is not zero.
+HRESULT WINAPI FindPgScan(
+    __in const FINDPG_PROVIDER* Provider,
+    __in ULONG BudgetSeconds,
+    __out_ecount_opt(Capacity) FINDPG_REGION* Regions,
+    __in ULONG Capacity,
+    __out ULONG* NumberOfRegions);
+
+// Finds PatchGuard pages in the same way as FindPgScan() with Options. Regions
+// of FINDPG_REGION_DECRYPTED are returned only by this function.
+HRESULT WINAPI FindPgScanEx(
+    __in const FINDPG_PROVIDER* Provider,
+    __in const FINDPG_SCAN_OPTIONS* Options,
+    __out_ecount_opt(Capacity) FINDPG_REGION* Regions,
+    __in ULONG Capacity,
+    __out ULONG* NumberOfRegions);
+
+// Finds PatchGuard pages in the same way as FindPgScanEx() against a trace
+// file recorded with !findpg -record instead of a live target, so that a scan
+// can be reproduced without the target or a debugger. Requests not found in
+// the trace fail. Output receives messages including the number of such
+// requests and is optional.
+HRESULT WINAPI FindPgReplay(
+    __in const char* Path,
+    __in const FINDPG_SCAN_OPTIONS* Options,
+    __in_opt void (CALLBACK* Output)(void* Context, const char* Text),
+    __in_opt void* Context,
+    __out_ecount_opt(Capacity) FINDPG_REGION* Regions,
+    __in ULONG Capacity,
+    __out ULONG* NumberOfRegions);
+
+// Copies the name of the built-in pattern at Index, which is Key of a region
+// of FINDPG_REGION_DECRYPTED. Returns E_INVALIDARG when there is no such
+// pattern, or S_FALSE when the name is truncated to fit Buffer.
+HRESULT WINAPI FindPgGetPatternName(
+    __in ULONG Index,
+    __out_ecount(BufferSize) char* Buffer,
+    __in ULONG BufferSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
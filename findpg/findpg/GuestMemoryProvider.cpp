@@ -0,0 +1,248 @@
+//
+// This module implements a class responsible for giving the scanner access to
+// guest physical memory of a virtual machine saved in a file.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "GuestMemoryProvider.h"
+#include "MappedFile.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+// Bits of a page table entry
+static const ULONG64 PTE_PRESENT = 1ull << 0;
+static const ULONG64 PTE_PAGE_SIZE = 1ull << 7;
+static const ULONG64 PTE_FRAME_MASK = 0x000ffffffffff000ull;
+
+// The number of attempts to copy a page that keeps being remapped by the guest
+static const ULONG MAXIMUM_READ_ATTEMPTS = 4;
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+GuestMemoryProvider::GuestMemoryProvider(
+    __in ScanProvider& Output)
+    : m_DirectoryTableBase(0)
+    , m_NumberOfLevels(4)
+    , m_IsLive(false)
+    , m_Output(Output)
+    , m_IsQuiet(false)
+    , m_NumberOfBytesRead(0)
+{
+}
+
+
+// Copies bytes page by page. As the debugger engine does, it fails only when
+// the first byte cannot be read and otherwise returns what was read.
+bool GuestMemoryProvider::ReadVirtual(
+    __in ULONG64 Address,
+    __out void* Buffer,
+    __in ULONG Size,
+    __out_opt ULONG* ReadBytes)
+{
+    ULONG readBytes = 0;
+    while (readBytes < Size)
+    {
+        const auto va = Address + readBytes;
+        const auto inPage = 0x1000 - (va & 0xfff);
+        ULONG length = 0;
+        if (!CopyWithinPage(va, static_cast<std::uint8_t*>(Buffer) + readBytes,
+            static_cast<ULONG>((std::min)(inPage,
+                static_cast<ULONG64>(Size - readBytes))), length))
+        {
+            break;
+        }
+        readBytes += length;
+    }
+    m_NumberOfBytesRead += readBytes;
+    if (ReadBytes)
+    {
+        *ReadBytes = readBytes;
+    }
+    return readBytes != 0;
+}
+
+
+bool GuestMemoryProvider::GetSymbolOffset(
+    __in const char* /*Symbol*/,
+    __out ULONG64& Offset)
+{
+    Offset = 0;
+    return false;
+}
+
+
+bool GuestMemoryProvider::GetTypeSize(
+    __in const char* /*Type*/,
+    __out ULONG& Size)
+{
+    Size = 0;
+    return false;
+}
+
+
+// Finds the entry in the kernel half of the top-level table that references
+// the table itself
+bool GuestMemoryProvider::GetPagingMode(
+    __out ULONG& NumberOfLevels,
+    __out ULONG64& SelfMapIndex)
+{
+    NumberOfLevels = m_NumberOfLevels;
+    SelfMapIndex = 0;
+    const auto table = m_DirectoryTableBase & PTE_FRAME_MASK;
+    for (ULONG64 index = 256; index < 512; ++index)
+    {
+        ULONG64 entry = 0;
+        if (ReadPhysicalEntry(table + index * sizeof(entry), entry) &&
+            (entry & PTE_PRESENT) && (entry & PTE_FRAME_MASK) == table)
+        {
+            SelfMapIndex = index;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void GuestMemoryProvider::Write(
+    __in const char* Text)
+{
+    if (!m_IsQuiet)
+    {
+        m_Output.Write(Text);
+    }
+}
+
+
+void GuestMemoryProvider::WriteError(
+    __in const char* Text)
+{
+    if (!m_IsQuiet)
+    {
+        m_Output.WriteError(Text);
+    }
+}
+
+
+bool GuestMemoryProvider::ReadPhysicalEntry(
+    __in ULONG64 PhysicalAddress,
+    __out ULONG64& Entry)
+{
+    ULONG64 available = 0;
+    const auto data = GetPhysical(PhysicalAddress, available);
+    if (!data || available < sizeof(Entry))
+    {
+        Entry = 0;
+        return false;
+    }
+    return MappedFile::Load(data, Entry);
+}
+
+
+// Copies bytes that do not cross a page boundary. When memory is live, the
+// address is translated again after the copy, and the page is copied again if
+// the guest has remapped it meanwhile, so that contents of a page that no
+// longer backs the address are not returned.
+bool GuestMemoryProvider::CopyWithinPage(
+    __in ULONG64 VirtualAddress,
+    __out void* Buffer,
+    __in ULONG Size,
+    __out ULONG& CopiedBytes)
+{
+    CopiedBytes = 0;
+    for (ULONG i = 0; i < MAXIMUM_READ_ATTEMPTS; ++i)
+    {
+        ULONG64 pa = 0;
+        ULONG64 available = 0;
+        const auto data = (Translate(VirtualAddress, pa))
+            ? GetPhysical(pa, available) : nullptr;
+        if (!data)
+        {
+            return false;
+        }
+        const auto length = static_cast<ULONG>((std::min)(available,
+            static_cast<ULONG64>(Size)));
+        if (!MappedFile::Copy(Buffer, data, length))
+        {
+            return false;
+        }
+        ULONG64 again = 0;
+        if (!m_IsLive || (Translate(VirtualAddress, again) && again == pa))
+        {
+            CopiedBytes = length;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Walks the 4 or 5-level page tables of the guest including 1GB and 2MB
+// pages
+bool GuestMemoryProvider::Translate(
+    __in ULONG64 VirtualAddress,
+    __out ULONG64& PhysicalAddress)
+{
+    static const ULONG shifts[] = { 48, 39, 30, 21, 12, };
+    auto table = m_DirectoryTableBase & PTE_FRAME_MASK;
+    for (SIZE_T level = _countof(shifts) - m_NumberOfLevels;
+        level < _countof(shifts); ++level)
+    {
+        const auto index = (VirtualAddress >> shifts[level]) & 0x1ff;
+        ULONG64 entry = 0;
+        if (!ReadPhysicalEntry(table + index * sizeof(entry), entry) ||
+            !(entry & PTE_PRESENT))
+        {
+            return false;
+        }
+
+        // A PPE or PDE mapping a large page
+        const auto pageMask = (1ull << shifts[level]) - 1;
+        if ((shifts[level] == 30 || shifts[level] == 21) &&
+            (entry & PTE_PAGE_SIZE))
+        {
+            PhysicalAddress = (entry & PTE_FRAME_MASK & ~pageMask)
+                | (VirtualAddress & pageMask);
+            return true;
+        }
+        table = entry & PTE_FRAME_MASK;
+    }
+    PhysicalAddress = table | (VirtualAddress & 0xfff);
+    return true;
+}
+
@@ -0,0 +1,130 @@
+//
+// This module declears a class responsible for giving the scanner access to
+// guest physical memory of a virtual machine saved in a file.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "ScanProvider.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Translates virtual addresses with the 4 or 5-level page tables of the guest
+// and reads them from guest physical memory provided by a subclass. Guest
+// memory has no symbols, so symbol lookups fail, and analysis relying on them
+// is skipped by the scanner.
+class GuestMemoryProvider : public ScanProvider
+{
+public:
+    GuestMemoryProvider(
+        __in ScanProvider& Output);
+
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes);
+
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset);
+
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size);
+
+    virtual bool GetPagingMode(
+        __out ULONG& NumberOfLevels,
+        __out ULONG64& SelfMapIndex);
+
+    virtual void Write(
+        __in const char* Text);
+
+    virtual void WriteError(
+        __in const char* Text);
+
+    ULONG64 GetDirectoryTableBase() const { return m_DirectoryTableBase; }
+    ULONG64 GetNumberOfBytesRead() const { return m_NumberOfBytesRead; }
+
+    // Discards all messages when true
+    void SetQuiet(
+        __in bool IsQuiet) { m_IsQuiet = IsQuiet; }
+
+protected:
+    // Returns a pointer to the guest physical address and the number of bytes
+    // contiguously available from there, or nullptr
+    virtual const std::uint8_t* GetPhysical(
+        __in ULONG64 PhysicalAddress,
+        __out ULONG64& Available) = 0;
+
+    // CR3 of the guest
+    ULONG64 m_DirectoryTableBase;
+
+    // 5 when the guest enables 5-level paging (CR4.LA57), otherwise 4
+    ULONG m_NumberOfLevels;
+
+    // Memory may change while it is read, so each page is translated again
+    // after it is copied
+    bool m_IsLive;
+
+private:
+    bool ReadPhysicalEntry(
+        __in ULONG64 PhysicalAddress,
+        __out ULONG64& Entry);
+
+    bool Translate(
+        __in ULONG64 VirtualAddress,
+        __out ULONG64& PhysicalAddress);
+
+    bool CopyWithinPage(
+        __in ULONG64 VirtualAddress,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out ULONG& CopiedBytes);
+
+    ScanProvider& m_Output;
+    bool m_IsQuiet;
+    ULONG64 m_NumberOfBytesRead;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,348 @@
+//
+// This module implements a class responsible for reading a large file through
+// a bounded number of mapped windows.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Windows headers
+// Original headers
+#include "MappedFile.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+MappedFile::MappedFile(
+    __in const std::string& Path,
+    __in bool AllowsWriters,
+    __in ULONG64 MaximumMappedBytes)
+#if defined(_WIN32)
+    : m_File(INVALID_HANDLE_VALUE)
+    , m_Mapping(nullptr)
+#else
+    : m_File(-1)
+#endif
+    , m_Size(0)
+    , m_MaximumWindows(MINIMUM_WINDOWS)
+    , m_UseCount(0)
+    , m_NumberOfMaps(0)
+{
+    if (MaximumMappedBytes / WINDOW_SIZE > m_MaximumWindows)
+    {
+        m_MaximumWindows = static_cast<SIZE_T>(
+            MaximumMappedBytes / WINDOW_SIZE);
+    }
+    Open(Path, AllowsWriters);
+}
+
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+
+const std::uint8_t* MappedFile::Map(
+    __in ULONG64 Offset,
+    __out ULONG64& Available)
+{
+    Available = 0;
+    if (Offset >= m_Size)
+    {
+        return nullptr;
+    }
+
+    // Use the window if it is already mapped
+    const auto windowOffset = Offset & ~(WINDOW_SIZE - 1);
+    auto window = m_Windows.find(windowOffset);
+    if (window == m_Windows.end())
+    {
+        // Unmap the least recently used window when there are too many. It
+        // is searched only when a window is mapped, which costs more.
+        if (m_Windows.size() >= m_MaximumWindows)
+        {
+            const auto leastRecentlyUsed = std::min_element(
+                m_Windows.begin(), m_Windows.end(),
+                [](const std::pair<const ULONG64, Window>& Lhs,
+                    const std::pair<const ULONG64, Window>& Rhs)
+            {
+                return Lhs.second.LastUse < Rhs.second.LastUse;
+            });
+            UnmapView(leastRecentlyUsed->second);
+            m_Windows.erase(leastRecentlyUsed);
+        }
+
+        Window newWindow = { nullptr, WINDOW_SIZE, 0, };
+        if (newWindow.Size > m_Size - windowOffset)
+        {
+            newWindow.Size = m_Size - windowOffset;
+        }
+        newWindow.View = MapView(windowOffset, newWindow.Size);
+        if (!newWindow.View)
+        {
+            return nullptr;
+        }
+        m_NumberOfMaps++;
+        window = m_Windows.emplace(windowOffset, newWindow).first;
+    }
+
+    window->second.LastUse = ++m_UseCount;
+    const auto offsetInWindow = Offset - windowOffset;
+    Available = window->second.Size - offsetInWindow;
+    return window->second.View + offsetInWindow;
+}
+
+
+bool MappedFile::Read(
+    __in ULONG64 Offset,
+    __out void* Buffer,
+    __in SIZE_T Size)
+{
+    SIZE_T readBytes = 0;
+    while (readBytes < Size)
+    {
+        ULONG64 available = 0;
+        const auto data = Map(Offset + readBytes, available);
+        if (!data)
+        {
+            return false;
+        }
+        const auto length = static_cast<SIZE_T>((std::min)(available,
+            static_cast<ULONG64>(Size - readBytes)));
+        if (!Copy(static_cast<std::uint8_t*>(Buffer) + readBytes, data,
+            length))
+        {
+            return false;
+        }
+        readBytes += length;
+    }
+    return true;
+}
+
+
+#if defined(_WIN32)
+
+void MappedFile::Open(
+    __in const std::string& Path,
+    __in bool AllowsWriters)
+{
+    const auto shareMode = (AllowsWriters)
+        ? FILE_SHARE_READ | FILE_SHARE_WRITE : FILE_SHARE_READ;
+    m_File = CreateFileA(Path.c_str(), GENERIC_READ, shareMode, nullptr,
+        OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE)
+    {
+        throw std::runtime_error(Path + " could not be opened.");
+    }
+    LARGE_INTEGER fileSize = {};
+    m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0,
+        nullptr);
+    if (!m_Mapping || !GetFileSizeEx(m_File, &fileSize))
+    {
+        Close();
+        throw std::runtime_error(Path + " could not be mapped.");
+    }
+    m_Size = fileSize.QuadPart;
+}
+
+
+const std::uint8_t* MappedFile::MapView(
+    __in ULONG64 Offset,
+    __in ULONG64 Size)
+{
+    LARGE_INTEGER offset = {};
+    offset.QuadPart = Offset;
+    return static_cast<const std::uint8_t*>(MapViewOfFile(m_Mapping,
+        FILE_MAP_READ, offset.HighPart, offset.LowPart,
+        static_cast<SIZE_T>(Size)));
+}
+
+
+void MappedFile::UnmapView(
+    __in const Window& Mapped)
+{
+    UnmapViewOfFile(Mapped.View);
+}
+
+
+void MappedFile::Close()
+{
+    for (const auto& window : m_Windows)
+    {
+        UnmapView(window.second);
+    }
+    m_Windows.clear();
+    if (m_Mapping)
+    {
+        CloseHandle(m_Mapping);
+        m_Mapping = nullptr;
+    }
+    if (m_File != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_File);
+        m_File = INVALID_HANDLE_VALUE;
+    }
+}
+
+
+// Structured exception handling cannot be used in a function with objects
+// that require unwinding, so copies from views are made by these functions
+bool MappedFile::Copy(
+    __out void* Buffer,
+    __in const std::uint8_t* View,
+    __in SIZE_T Size)
+{
+    __try
+    {
+        memcpy(Buffer, View, Size);
+        return true;
+    }
+    __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR
+        ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        return false;
+    }
+}
+
+
+bool MappedFile::Load(
+    __in const std::uint8_t* View,
+    __out ULONG64& Value)
+{
+    __try
+    {
+        Value = *reinterpret_cast<const volatile ULONG64*>(View);
+        return true;
+    }
+    __except (GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR
+        ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        Value = 0;
+        return false;
+    }
+}
+
+#else
+
+// Other processes are never prevented from writing to the file on these
+// platforms, so AllowsWriters has no effect
+void MappedFile::Open(
+    __in const std::string& Path,
+    __in bool AllowsWriters)
+{
+    UNREFERENCED_PARAMETER(AllowsWriters);
+    m_File = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_File == -1)
+    {
+        throw std::runtime_error(Path + " could not be opened.");
+    }
+    struct stat status = {};
+    if (fstat(m_File, &status) != 0)
+    {
+        Close();
+        throw std::runtime_error(Path + " could not be mapped.");
+    }
+    m_Size = status.st_size;
+    posix_fadvise(m_File, 0, 0, POSIX_FADV_RANDOM);
+}
+
+
+const std::uint8_t* MappedFile::MapView(
+    __in ULONG64 Offset,
+    __in ULONG64 Size)
+{
+    const auto view = mmap(nullptr, static_cast<SIZE_T>(Size), PROT_READ,
+        MAP_SHARED, m_File, static_cast<off_t>(Offset));
+    return (view != MAP_FAILED) ? static_cast<const std::uint8_t*>(view)
+        : nullptr;
+}
+
+
+// Unmapping also drops pages of the window from the resident set
+void MappedFile::UnmapView(
+    __in const Window& Mapped)
+{
+    munmap(const_cast<std::uint8_t*>(Mapped.View),
+        static_cast<SIZE_T>(Mapped.Size));
+}
+
+
+void MappedFile::Close()
+{
+    for (const auto& window : m_Windows)
+    {
+        UnmapView(window.second);
+    }
+    m_Windows.clear();
+    if (m_File != -1)
+    {
+        close(m_File);
+        m_File = -1;
+    }
+}
+
+
+// Bytes that cannot be paged in, for example, because the file has been
+// shrunk by another process, raise SIGBUS on these platforms, which is not
+// handled here
+bool MappedFile::Copy(
+    __out void* Buffer,
+    __in const std::uint8_t* View,
+    __in SIZE_T Size)
+{
+    memcpy(Buffer, View, Size);
+    return true;
+}
+
+
+bool MappedFile::Load(
+    __in const std::uint8_t* View,
+    __out ULONG64& Value)
+{
+    Value = *reinterpret_cast<const volatile ULONG64*>(View);
+    return true;
+}
+
+#endif
+
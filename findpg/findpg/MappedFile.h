@@ -0,0 +1,154 @@
+//
+// This module declears a class responsible for reading a large file through
+// a bounded number of mapped windows.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Maps windows of a file on demand and keeps no more than a given number of
+// bytes mapped at once, so that a file larger than physical memory can be
+// read with a bounded working set. The least recently used window is
+// unmapped first, which also removes its pages from the working set. Files
+// are mapped with MapViewOfFile() on Windows and mmap() on other platforms.
+class MappedFile
+{
+public:
+    // Opens the file. When AllowsWriters is true, other processes may keep
+    // writing to it. Throws std::runtime_error when it cannot be mapped.
+    MappedFile(
+        __in const std::string& Path,
+        __in bool AllowsWriters,
+        __in ULONG64 MaximumMappedBytes);
+
+    ~MappedFile();
+
+    // Returns a pointer to the byte at Offset and the number of bytes
+    // available contiguously from there, or nullptr when Offset is out of the
+    // file. The pointer is valid until the window is evicted by another call.
+    const std::uint8_t* Map(
+        __in ULONG64 Offset,
+        __out ULONG64& Available);
+
+    // Copies bytes at Offset. Returns false when they are not in the file.
+    bool Read(
+        __in ULONG64 Offset,
+        __out void* Buffer,
+        __in SIZE_T Size);
+
+    // Copies bytes from a pointer returned by Map(). On Windows, returns
+    // false instead of raising EXCEPTION_IN_PAGE_ERROR when they cannot be
+    // paged in, for example, because the file has been shrunk by another
+    // process.
+    static bool Copy(
+        __out void* Buffer,
+        __in const std::uint8_t* View,
+        __in SIZE_T Size);
+
+    // Reads an aligned 8-byte value from a pointer returned by Map() with a
+    // single load in the same way as Copy()
+    static bool Load(
+        __in const std::uint8_t* View,
+        __out ULONG64& Value);
+
+    ULONG64 GetSize() const { return m_Size; }
+    ULONG64 GetMaximumMappedBytes() const
+    {
+        return m_MaximumWindows * WINDOW_SIZE;
+    }
+    SIZE_T GetNumberOfMaps() const { return m_NumberOfMaps; }
+
+    SIZE_T GetNumberOfWindows() const { return m_Windows.size(); }
+
+    static ULONG64 GetWindowSize() { return WINDOW_SIZE; }
+
+private:
+    struct Window
+    {
+        const std::uint8_t* View;
+        ULONG64 Size;
+        std::uint64_t LastUse;
+    };
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    // Functions below are implemented for each platform
+    void Open(
+        __in const std::string& Path,
+        __in bool AllowsWriters);
+
+    const std::uint8_t* MapView(
+        __in ULONG64 Offset,
+        __in ULONG64 Size);
+
+    void UnmapView(
+        __in const Window& Mapped);
+
+    void Close();
+
+    // The size of a window. It is a multiple of the allocation granularity.
+    static const ULONG64 WINDOW_SIZE = 16 * 1024 * 1024;
+
+    // The minimum number of windows. A page table entry and the page it
+    // references may be in different windows.
+    static const SIZE_T MINIMUM_WINDOWS = 2;
+
+#if defined(_WIN32)
+    HANDLE m_File;
+    HANDLE m_Mapping;
+#else
+    int m_File;     // A file descriptor
+#endif
+    ULONG64 m_Size;
+    SIZE_T m_MaximumWindows;
+    std::map<ULONG64, Window> m_Windows;    // Keyed by offsets of windows
+    std::uint64_t m_UseCount;
+    SIZE_T m_NumberOfMaps;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,233 @@
+//
+// This module implements a class responsible for remembering address ranges
+// that cannot be read.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "NegativeReadCache.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+NegativeReadCache::NegativeReadCache(
+    __in ScanProvider& Provider)
+    : m_Provider(Provider)
+    , m_NumberOfHits(0)
+    , m_NumberOfMisses(0)
+{
+}
+
+
+// A read fails only when its first byte cannot be read; otherwise, a part of
+// it is returned. So only the page containing Address is checked, and it is
+// recorded only when nothing was read.
+bool NegativeReadCache::ReadVirtual(
+    __in ULONG64 Address,
+    __out void* Buffer,
+    __in ULONG Size,
+    __out_opt ULONG* ReadBytes)
+{
+    if (IsUnreadable(Address))
+    {
+        m_NumberOfHits++;
+        if (ReadBytes)
+        {
+            *ReadBytes = 0;
+        }
+        return false;
+    }
+    ULONG readBytes = 0;
+    const auto result = m_Provider.ReadVirtual(Address, Buffer, Size,
+        &readBytes);
+    if (ReadBytes)
+    {
+        *ReadBytes = readBytes;
+    }
+    if (!result && !readBytes)
+    {
+        m_NumberOfMisses++;
+        AddUnreadable(Address);
+    }
+    return result;
+}
+
+
+bool NegativeReadCache::ReadPointer(
+    __in ULONG64 Address,
+    __out ULONG64& Value)
+{
+    if (IsUnreadable(Address))
+    {
+        m_NumberOfHits++;
+        Value = 0;
+        return false;
+    }
+    if (!m_Provider.ReadPointer(Address, Value))
+    {
+        m_NumberOfMisses++;
+        AddUnreadable(Address);
+        return false;
+    }
+    return true;
+}
+
+
+bool NegativeReadCache::GetNextDifferentlyValidOffset(
+    __in ULONG64 Address,
+    __out ULONG64& NextAddress)
+{
+    return m_Provider.GetNextDifferentlyValidOffset(Address, NextAddress);
+}
+
+
+bool NegativeReadCache::GetSymbolOffset(
+    __in const char* Symbol,
+    __out ULONG64& Offset)
+{
+    return m_Provider.GetSymbolOffset(Symbol, Offset);
+}
+
+
+bool NegativeReadCache::GetTypeSize(
+    __in const char* Type,
+    __out ULONG& Size)
+{
+    return m_Provider.GetTypeSize(Type, Size);
+}
+
+
+bool NegativeReadCache::GetFieldOffset(
+    __in const char* Type,
+    __in const char* Field,
+    __out ULONG& Offset)
+{
+    return m_Provider.GetFieldOffset(Type, Field, Offset);
+}
+
+
+bool NegativeReadCache::GetPagingMode(
+    __out ULONG& NumberOfLevels,
+    __out ULONG64& SelfMapIndex)
+{
+    return m_Provider.GetPagingMode(NumberOfLevels, SelfMapIndex);
+}
+
+
+bool NegativeReadCache::GetModuleIdentity(
+    __in const char* Module,
+    __out ULONG64& Base,
+    __out ULONG& TimeDateStamp,
+    __out ULONG& SizeOfImage)
+{
+    return m_Provider.GetModuleIdentity(Module, Base, TimeDateStamp,
+        SizeOfImage);
+}
+
+
+void NegativeReadCache::Write(
+    __in const char* Text)
+{
+    m_Provider.Write(Text);
+}
+
+
+void NegativeReadCache::WriteError(
+    __in const char* Text)
+{
+    m_Provider.WriteError(Text);
+}
+
+
+bool NegativeReadCache::IsUnreadable(
+    __in ULONG64 Address) const
+{
+    auto it = m_Ranges.upper_bound(Address);
+    if (it == m_Ranges.begin())
+    {
+        return false;
+    }
+    --it;
+    return Address < it->second;
+}
+
+
+// Adds the page containing Address and the rest of the range the provider
+// reports as equally unreadable, and merges it with adjacent ranges
+void NegativeReadCache::AddUnreadable(
+    __in ULONG64 Address)
+{
+    auto start = Address & ~0xfffull;
+    auto end = start + 0x1000;
+    ULONG64 next = 0;
+    if (m_Provider.GetNextDifferentlyValidOffset(Address, next) &&
+        (next & ~0xfffull) > end)
+    {
+        end = next & ~0xfffull;
+    }
+    if (end < start)
+    {
+        // Wrapped around the end of the address space
+        end = ~0ull;
+    }
+
+    // Merge with a range that overlaps or touches the new range from below
+    auto it = m_Ranges.upper_bound(start);
+    if (it != m_Ranges.begin())
+    {
+        auto previous = it;
+        --previous;
+        if (previous->second >= start)
+        {
+            start = previous->first;
+            end = (std::max)(end, previous->second);
+            m_Ranges.erase(previous);
+        }
+    }
+
+    // Merge with ranges that start inside or right after the new range
+    it = m_Ranges.lower_bound(start);
+    while (it != m_Ranges.end() && it->first <= end)
+    {
+        end = (std::max)(end, it->second);
+        it = m_Ranges.erase(it);
+    }
+    m_Ranges.emplace(start, end);
+}
+
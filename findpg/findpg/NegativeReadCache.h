@@ -0,0 +1,131 @@
+//
+// This module declears a class responsible for remembering address ranges
+// that cannot be read.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <map>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "ScanProvider.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Forwards requests to another provider and fails reads starting in a page
+// known to be unreadable without issuing them. When a read fails, the page is
+// remembered together with the rest of the unreadable range reported by the
+// provider, such as a range missing in a dump file. Adjacent ranges are
+// coalesced.
+class NegativeReadCache : public ScanProvider
+{
+public:
+    NegativeReadCache(
+        __in ScanProvider& Provider);
+
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes);
+
+    virtual bool ReadPointer(
+        __in ULONG64 Address,
+        __out ULONG64& Value);
+
+    virtual bool GetNextDifferentlyValidOffset(
+        __in ULONG64 Address,
+        __out ULONG64& NextAddress);
+
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset);
+
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size);
+
+    virtual bool GetFieldOffset(
+        __in const char* Type,
+        __in const char* Field,
+        __out ULONG& Offset);
+
+    virtual bool GetPagingMode(
+        __out ULONG& NumberOfLevels,
+        __out ULONG64& SelfMapIndex);
+
+    virtual bool GetModuleIdentity(
+        __in const char* Module,
+        __out ULONG64& Base,
+        __out ULONG& TimeDateStamp,
+        __out ULONG& SizeOfImage);
+
+    virtual void Write(
+        __in const char* Text);
+
+    virtual void WriteError(
+        __in const char* Text);
+
+    // The number of reads failed without being issued
+    SIZE_T GetNumberOfHits() const { return m_NumberOfHits; }
+
+    // The number of reads issued and failed
+    SIZE_T GetNumberOfMisses() const { return m_NumberOfMisses; }
+
+    SIZE_T GetNumberOfRanges() const { return m_Ranges.size(); }
+
+private:
+    bool IsUnreadable(
+        __in ULONG64 Address) const;
+
+    void AddUnreadable(
+        __in ULONG64 Address);
+
+    ScanProvider& m_Provider;
+
+    // Start -> end (exclusive) of unreadable ranges that do not overlap or
+    // touch each other
+    std::map<ULONG64, ULONG64> m_Ranges;
+
+    SIZE_T m_NumberOfHits;
+    SIZE_T m_NumberOfMisses;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,241 @@
+//
+// This module implements a class responsible for keeping a sparse snapshot of
+// kernel page tables during a debugger session.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "PageTableSnapshot.h"
+#include "PteFilter.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+PageTableSnapshot::PageTableSnapshot()
+    : m_EntryChunkUsed(0)
+    , m_NumberOfFetches(0)
+    , m_NumberOfBatchedReads(0)
+    , m_NumberOfCachedEntries(0)
+{
+}
+
+
+bool PageTableSnapshot::GetTable(
+    __in ScanProvider& Data,
+    __in ULONG64 TableBase,
+    __out PageTable& Table)
+{
+    const auto table = Fetch(Data, TableBase);
+    if (!table)
+    {
+        return false;
+    }
+
+    Table.fill(HARDWARE_PTE());
+    SIZE_T entryIndex = 0;
+    for (SIZE_T i = 0; i < Table.size(); ++i)
+    {
+        if (table->ValidMap[i / 64] & (1ULL << (i % 64)))
+        {
+            Table[i] = table->Entries[entryIndex++];
+        }
+    }
+    return true;
+}
+
+
+bool PageTableSnapshot::GetEntry(
+    __in ScanProvider& Data,
+    __in ULONG64 PteAddr,
+    __out HARDWARE_PTE& Entry)
+{
+    const auto table = Fetch(Data, PteAddr & ~0xfffULL);
+    if (!table)
+    {
+        return false;
+    }
+
+    // Locate the entry by counting valid entries preceding it
+    const auto index = (PteAddr & 0xfff) / sizeof(HARDWARE_PTE);
+    const auto bit = 1ULL << (index % 64);
+    if (!(table->ValidMap[index / 64] & bit))
+    {
+        Entry = HARDWARE_PTE();
+        return true;
+    }
+    SIZE_T entryIndex = CountSetBits(table->ValidMap[index / 64] & (bit - 1));
+    for (SIZE_T i = 0; i < index / 64; ++i)
+    {
+        entryIndex += CountSetBits(table->ValidMap[i]);
+    }
+    Entry = table->Entries[entryIndex];
+    return true;
+}
+
+
+void PageTableSnapshot::Prefetch(
+    __in ScanProvider& Data,
+    __in ULONG64 FirstTableBase,
+    __in SIZE_T NumberOfTables)
+{
+    while (NumberOfTables)
+    {
+        // Skip page tables already known
+        if (m_Tables.count(FirstTableBase >> 12))
+        {
+            FirstTableBase += 0x1000;
+            NumberOfTables--;
+            continue;
+        }
+
+        // A single page table is read by Fetch() as usual
+        auto count = NumberOfTables;
+        if (count > MAXIMUM_BATCH_SIZE)
+        {
+            count = MAXIMUM_BATCH_SIZE;
+        }
+        if (count == 1)
+        {
+            return;
+        }
+
+        // Read multiple page tables at once. If the read fails or stops in the
+        // middle, only page tables completely read are stored, and the others
+        // are read individually later.
+        m_BatchBuffer.resize(512 * count);
+        m_NumberOfBatchedReads++;
+        ULONG readBytes = 0;
+        if (!Data.ReadVirtual(FirstTableBase, m_BatchBuffer.data(),
+            static_cast<ULONG>(m_BatchBuffer.size() * sizeof(HARDWARE_PTE)),
+            &readBytes))
+        {
+            return;
+        }
+        const auto tablesRead = readBytes / 0x1000;
+        for (SIZE_T i = 0; i < tablesRead; ++i)
+        {
+            const auto tableBase = FirstTableBase + 0x1000 * i;
+            if (!m_Tables.count(tableBase >> 12))
+            {
+                m_NumberOfFetches++;
+                Store(tableBase, &m_BatchBuffer[512 * i]);
+            }
+        }
+        if (tablesRead != count)
+        {
+            return;
+        }
+        FirstTableBase += 0x1000 * count;
+        NumberOfTables -= count;
+    }
+}
+
+
+void PageTableSnapshot::Clear()
+{
+    m_Tables.clear();
+    m_EntryChunks.clear();
+    m_EntryChunkUsed = 0;
+    m_NumberOfFetches = 0;
+    m_NumberOfBatchedReads = 0;
+    m_NumberOfCachedEntries = 0;
+}
+
+
+// Returns a cached page table or reads it from the target when it has not
+// been read yet
+const PageTableSnapshot::CompactTable* PageTableSnapshot::Fetch(
+    __in ScanProvider& Data,
+    __in ULONG64 TableBase)
+{
+    const auto key = TableBase >> 12;
+    const auto it = m_Tables.find(key);
+    if (it != m_Tables.end())
+    {
+        return (it->second.IsReadable) ? &it->second : nullptr;
+    }
+
+    m_NumberOfFetches++;
+    ULONG readBytes = 0;
+    PageTable ptes;
+    if (!Data.ReadVirtual(TableBase, ptes.data(),
+        static_cast<ULONG>(ptes.size() * sizeof(HARDWARE_PTE)), &readBytes) ||
+        readBytes != ptes.size() * sizeof(HARDWARE_PTE))
+    {
+        CompactTable table = {};
+        m_Tables.emplace(key, table);
+        return nullptr;
+    }
+
+    return Store(TableBase, ptes.data());
+}
+
+
+// Packs valid entries of the page table and caches it
+const PageTableSnapshot::CompactTable* PageTableSnapshot::Store(
+    __in ULONG64 TableBase,
+    __in const HARDWARE_PTE* Ptes)
+{
+    // Take space for all entries from the last chunk, or a new chunk when it
+    // does not have enough space left
+    if (m_EntryChunks.empty() || m_EntryChunkUsed + 512 > ENTRY_CHUNK_SIZE)
+    {
+        m_EntryChunks.emplace_back(new HARDWARE_PTE[ENTRY_CHUNK_SIZE]);
+        m_EntryChunkUsed = 0;
+    }
+    const auto entries = m_EntryChunks.back().get() + m_EntryChunkUsed;
+
+    CompactTable table = {};
+    table.IsReadable = true;
+    SIZE_T numberOfEntries = 0;
+    for (SIZE_T i = 0; i < 512; ++i)
+    {
+        if (Ptes[i].Valid)
+        {
+            table.ValidMap[i / 64] |= 1ULL << (i % 64);
+            entries[numberOfEntries++] = Ptes[i];
+        }
+    }
+    table.Entries = entries;
+    m_EntryChunkUsed += numberOfEntries;
+    m_NumberOfCachedEntries += numberOfEntries;
+
+    return &m_Tables.emplace(TableBase >> 12, table).first->second;
+}
+
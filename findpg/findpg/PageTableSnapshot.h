@@ -0,0 +1,130 @@
+//
+// This module declears a class responsible for keeping a sparse snapshot of
+// kernel page tables during a debugger session.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "pte.h"
+#include "ScanProvider.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Caches page table pages read through the self-map so that each of them is
+// fetched from the target at most once until the target runs again. Only
+// valid entries are kept, packed behind a bitmap of valid indexes, and pages
+// that could not be read are remembered as well. Packed entries of all pages
+// share large chunks so that caching a page does not allocate memory for it.
+class PageTableSnapshot
+{
+public:
+    typedef std::array<HARDWARE_PTE, 512> PageTable;
+
+    PageTableSnapshot();
+
+    // Fills Table with the page table at TableBase. Invalid entries are
+    // zeroed. Returns false when the page table could not be read.
+    bool GetTable(
+        __in ScanProvider& Data,
+        __in ULONG64 TableBase,
+        __out PageTable& Table);
+
+    // Returns false when the page table containing PteAddr could not be
+    // read. Otherwise, Entry is set (zero when it is not valid).
+    bool GetEntry(
+        __in ScanProvider& Data,
+        __in ULONG64 PteAddr,
+        __out HARDWARE_PTE& Entry);
+
+    // Reads NumberOfTables page tables contiguous in the self-map starting at
+    // FirstTableBase with as few reads as possible. Page tables that could not
+    // be read this way are left for GetTable() and GetEntry().
+    void Prefetch(
+        __in ScanProvider& Data,
+        __in ULONG64 FirstTableBase,
+        __in SIZE_T NumberOfTables);
+
+    // Discards all cached page tables
+    void Clear();
+
+    SIZE_T GetNumberOfFetches() const { return m_NumberOfFetches; }
+    SIZE_T GetNumberOfBatchedReads() const { return m_NumberOfBatchedReads; }
+    SIZE_T GetNumberOfCachedEntries() const { return m_NumberOfCachedEntries; }
+
+private:
+    struct CompactTable
+    {
+        bool IsReadable;
+        std::array<std::uint64_t, 512 / 64> ValidMap;
+        const HARDWARE_PTE* Entries;    // Valid entries in index order
+    };
+
+    const CompactTable* Fetch(
+        __in ScanProvider& Data,
+        __in ULONG64 TableBase);
+
+    const CompactTable* Store(
+        __in ULONG64 TableBase,
+        __in const HARDWARE_PTE* Ptes);
+
+    // The maximum number of page tables read at once
+    static const SIZE_T MAXIMUM_BATCH_SIZE = 64;
+
+    // The number of entries in a chunk holding packed entries
+    static const SIZE_T ENTRY_CHUNK_SIZE = 0x10000;
+
+    // Page tables keyed by their page frame in the self-map
+    std::unordered_map<ULONG64, CompactTable> m_Tables;
+    std::vector<std::unique_ptr<HARDWARE_PTE[]>> m_EntryChunks;
+    SIZE_T m_EntryChunkUsed;    // The number of entries used in the last chunk
+    SIZE_T m_NumberOfFetches;
+    SIZE_T m_NumberOfBatchedReads;
+    SIZE_T m_NumberOfCachedEntries;
+    std::vector<HARDWARE_PTE> m_BatchBuffer;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,190 @@
+//
+// This module implements paging modes of x64 and addresses of page tables
+// mapped through the self-map in each of them.
+//
+// To support a new mode, define a new traits class with the same members as
+// the existing ones and add it to the dispatch in
+// Scanner::FindPgPagesFromIndependentPages(). The mode is selected once per
+// scan, and a walker specialized for it is instantiated so that address
+// calculation of each entry uses constants of the mode.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <array>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "pte.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+// The index of the self-map in PML4 before Windows 10 1607. It is randomized
+// on later versions.
+static const ULONG64 CLASSIC_SELF_MAP_INDEX = 0x1ed;
+
+// The index of the entry in the top-level table whose region starts with
+// NonPagedPool on Windows 8.1, where nt!MmNonPagedPoolStart does not exist
+static const ULONG64 NON_PAGED_POOL_TOP_LEVEL_INDEX = 0x1c0;
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Levels of page tables named after their entries
+enum PageTableLevel : ULONG
+{
+    PteLevel,
+    PdeLevel,
+    PpeLevel,
+    PxeLevel,       // PML4
+    Pml5eLevel,     // PML5, only with 5-level paging
+};
+
+
+// 4-level paging with either the classic or a relocated self-map
+struct FourLevelPaging
+{
+    static const ULONG NumberOfLevels = 4;
+    static const ULONG VirtualAddressBits = 48;
+};
+
+
+// 5-level paging enabled by CR4.LA57
+struct FiveLevelPaging
+{
+    static const ULONG NumberOfLevels = 5;
+    static const ULONG VirtualAddressBits = 57;
+};
+
+
+// Addresses of page tables mapped by the self-map entry in the top-level
+// table. Indexes of entries are counted from the bottom of the address space
+// as MiAddressToPte() does, so that the index of an entry is also the index of
+// the table it references.
+template <typename Mode>
+class PagingLayout
+{
+public:
+    explicit PagingLayout(
+        __in ULONG64 SelfMapIndex)
+        : m_SelfMapIndex(SelfMapIndex)
+    {
+        // Page tables are mapped at the region of the self-map, and each
+        // upper level is mapped inside the region of the level below it
+        auto base = SignExtend(SelfMapIndex << (Mode::VirtualAddressBits - 9));
+        for (ULONG level = 0; level < m_TableBases.size(); ++level)
+        {
+            m_TableBases[level] = base;
+            base += SelfMapIndex << (Mode::VirtualAddressBits - 18 - 9 * level);
+        }
+    }
+
+    ULONG64 GetSelfMapIndex() const { return m_SelfMapIndex; }
+
+    // Returns the index of the self-map when PteBase is the base of PTEs in
+    // this mode, or zero when it is not. Zero is never a valid index since
+    // the self-map is in the kernel half.
+    static ULONG64 FindSelfMapIndex(
+        __in ULONG64 PteBase)
+    {
+        const auto index = GetIndex(Mode::NumberOfLevels - 1, PteBase);
+        if (index < 0x100 ||
+            PagingLayout(index).GetTable(PteLevel, 0) != PteBase)
+        {
+            return 0;
+        }
+        return index;
+    }
+
+    // Returns the address of the table at Level referenced by the entry at
+    // Index of the level above
+    ULONG64 GetTable(
+        __in ULONG Level,
+        __in ULONG64 Index) const
+    {
+        return m_TableBases[Level] + (Index << PTI_SHIFT);
+    }
+
+    // Returns the address of the entry at Level mapping the address
+    ULONG64 GetEntry(
+        __in ULONG Level,
+        __in ULONG64 Address) const
+    {
+        return m_TableBases[Level] + (GetIndex(Level, Address) << 3);
+    }
+
+    // Returns the index of the entry at Level mapping the address
+    static ULONG64 GetIndex(
+        __in ULONG Level,
+        __in ULONG64 Address)
+    {
+        return (Address & VIRTUAL_ADDRESS_MASK) >> (PTI_SHIFT + 9 * Level);
+    }
+
+    // Returns the base address of the region mapped by the entry at Index of
+    // Level
+    static ULONG64 GetAddress(
+        __in ULONG Level,
+        __in ULONG64 Index)
+    {
+        return SignExtend(Index << (PTI_SHIFT + 9 * Level));
+    }
+
+    // Returns the base address of the region used by NonPagedPool when it is
+    // not known from the target
+    static ULONG64 GetDefaultNonPagedPoolStart()
+    {
+        return GetAddress(Mode::NumberOfLevels - 1,
+            NON_PAGED_POOL_TOP_LEVEL_INDEX);
+    }
+
+    static ULONG64 SignExtend(
+        __in ULONG64 Address)
+    {
+        return static_cast<ULONG64>(static_cast<LONG64>(
+            Address << (64 - Mode::VirtualAddressBits))
+                >> (64 - Mode::VirtualAddressBits));
+    }
+
+private:
+    static const ULONG64 VIRTUAL_ADDRESS_MASK =
+        (1ull << Mode::VirtualAddressBits) - 1;
+
+    ULONG64 m_SelfMapIndex;
+    std::array<ULONG64, Mode::NumberOfLevels> m_TableBases;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,202 @@
+//
+// This module implements a class responsible for searching memory for byte
+// patterns of PatchGuard code and contexts.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+#include <fstream>
+#include <emmintrin.h>
+#include <intrin.h>
+
+// Other external headers
+// Windows headers
+// Original headers
+#include "PatternMatcher.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+void PatternMatcher::Add(
+    __in const std::string& Name,
+    __in const std::string& HexBytes)
+{
+    Pattern pattern = { Name, };
+    std::istringstream ss(HexBytes);
+    std::string token;
+    while (ss >> token)
+    {
+        if (token == "??")
+        {
+            pattern.Bytes.push_back(0);
+            pattern.Mask.push_back(0);
+            continue;
+        }
+        char* end = nullptr;
+        const auto value = strtoul(token.c_str(), &end, 16);
+        if (token.size() != 2 || *end != '\0' || value > 0xff)
+        {
+            throw std::runtime_error("Pattern " + Name
+                + " has an invalid byte " + token + ".");
+        }
+        pattern.Bytes.push_back(static_cast<std::uint8_t>(value));
+        pattern.Mask.push_back(0xff);
+    }
+    if (pattern.Bytes.empty() || !pattern.Mask[0])
+    {
+        throw std::runtime_error("Pattern " + Name
+            + " has to start with a byte other than a wildcard.");
+    }
+
+    const auto firstByte = pattern.Bytes[0];
+    if (m_PatternsByFirstByte[firstByte].empty())
+    {
+        m_FirstBytes.push_back(firstByte);
+    }
+    m_PatternsByFirstByte[firstByte].push_back(m_Patterns.size());
+    m_Patterns.push_back(pattern);
+}
+
+
+// The head of contexts is a copy of CmpAppendDllSection, which decrypts the
+// rest of the context and is never encrypted itself
+void PatternMatcher::AddDefaultPatterns()
+{
+    Add("CmpAppendDllSection",
+        "2E 48 31 11 48 31 51 08 48 31 51 10 48 31 51 18");
+}
+
+
+void PatternMatcher::LoadFile(
+    __in const std::string& Path)
+{
+    std::ifstream file(Path);
+    if (!file)
+    {
+        throw std::runtime_error(Path + " could not be opened.");
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream ss(line);
+        std::string name;
+        if (!(ss >> name) || name[0] == '#')
+        {
+            continue;
+        }
+        std::string hexBytes;
+        std::getline(ss, hexBytes);
+        Add(name, hexBytes);
+    }
+}
+
+
+void PatternMatcher::Search(
+    __in const std::uint8_t* Data,
+    __in SIZE_T Size,
+    __inout std::vector<Match>& Matches) const
+{
+    SIZE_T offset = 0;
+    if (!m_FirstBytes.empty() &&
+        m_FirstBytes.size() <= MAXIMUM_VECTOR_FIRST_BYTES)
+    {
+        __m128i firstBytes[MAXIMUM_VECTOR_FIRST_BYTES];
+        for (SIZE_T i = 0; i < m_FirstBytes.size(); ++i)
+        {
+            firstBytes[i] = _mm_set1_epi8(static_cast<char>(m_FirstBytes[i]));
+        }
+        for (; offset + sizeof(__m128i) <= Size; offset += sizeof(__m128i))
+        {
+            const auto block = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(Data + offset));
+            auto equal = _mm_cmpeq_epi8(block, firstBytes[0]);
+            for (SIZE_T i = 1; i < m_FirstBytes.size(); ++i)
+            {
+                equal = _mm_or_si128(equal,
+                    _mm_cmpeq_epi8(block, firstBytes[i]));
+            }
+            auto bits = static_cast<unsigned long>(_mm_movemask_epi8(equal));
+            unsigned long bit = 0;
+            while (_BitScanForward(&bit, bits))
+            {
+                bits &= bits - 1;
+                Verify(Data, Size, offset + bit, Matches);
+            }
+        }
+    }
+
+    // The remaining bytes, or all bytes when there are too many first bytes
+    for (; offset < Size; ++offset)
+    {
+        if (!m_PatternsByFirstByte[Data[offset]].empty())
+        {
+            Verify(Data, Size, offset, Matches);
+        }
+    }
+}
+
+
+// Compares patterns starting with the byte at Offset
+void PatternMatcher::Verify(
+    __in const std::uint8_t* Data,
+    __in SIZE_T Size,
+    __in SIZE_T Offset,
+    __inout std::vector<Match>& Matches) const
+{
+    for (const auto index : m_PatternsByFirstByte[Data[Offset]])
+    {
+        const auto& pattern = m_Patterns[index];
+        if (Size - Offset < pattern.Bytes.size())
+        {
+            continue;
+        }
+        auto isMatched = true;
+        for (SIZE_T i = 1; i < pattern.Bytes.size(); ++i)
+        {
+            if ((Data[Offset + i] & pattern.Mask[i]) != pattern.Bytes[i])
+            {
+                isMatched = false;
+                break;
+            }
+        }
+        if (isMatched)
+        {
+            const Match match = { Offset, index, };
+            Matches.push_back(match);
+        }
+    }
+}
+
@@ -0,0 +1,125 @@
+//
+// This module declears a class responsible for searching memory for byte
+// patterns of PatchGuard code and contexts.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <array>
+#include <string>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Searches a buffer for multiple byte patterns at once.
+//
+// Positions whose byte equals the first byte of any pattern are selected 16
+// bytes at a time with SSE2, and only patterns starting with that byte are
+// compared there. As long as patterns start with a few distinct bytes, most
+// of a buffer is skipped without being compared byte by byte. Patterns may
+// contain wildcards except for their first bytes.
+class PatternMatcher
+{
+public:
+    struct Match
+    {
+        SIZE_T Offset;          // Offset in the searched buffer
+        SIZE_T PatternIndex;
+    };
+
+    // Adds a pattern written in hex such as "2E 48 ?? 11". "??" matches any
+    // byte. Throws std::runtime_error when the pattern is malformed.
+    void Add(
+        __in const std::string& Name,
+        __in const std::string& HexBytes);
+
+    // Adds patterns of PatchGuard known to remain unencrypted
+    void AddDefaultPatterns();
+
+    // Adds patterns in a file. Each line has a name followed by a pattern,
+    // and lines starting with '#' are ignored.
+    void LoadFile(
+        __in const std::string& Path);
+
+    // Appends all matches in the buffer to Matches
+    void Search(
+        __in const std::uint8_t* Data,
+        __in SIZE_T Size,
+        __inout std::vector<Match>& Matches) const;
+
+    SIZE_T GetNumberOfPatterns() const { return m_Patterns.size(); }
+
+    const std::string& GetName(
+        __in SIZE_T Index) const { return m_Patterns[Index].Name; }
+
+    SIZE_T GetLength(
+        __in SIZE_T Index) const { return m_Patterns[Index].Bytes.size(); }
+
+private:
+    struct Pattern
+    {
+        std::string Name;
+        std::vector<std::uint8_t> Bytes;
+        std::vector<std::uint8_t> Mask;     // 0x00 for a wildcard
+    };
+
+    void Verify(
+        __in const std::uint8_t* Data,
+        __in SIZE_T Size,
+        __in SIZE_T Offset,
+        __inout std::vector<Match>& Matches) const;
+
+    // The maximum number of distinct first bytes compared with SSE2. Above
+    // this, a lookup table is used for each byte instead.
+    static const SIZE_T MAXIMUM_VECTOR_FIRST_BYTES = 8;
+
+    std::vector<Pattern> m_Patterns;
+
+    // Indexes of patterns for each first byte
+    std::array<std::vector<SIZE_T>, 256> m_PatternsByFirstByte;
+
+    // Distinct first bytes of all patterns
+    std::vector<std::uint8_t> m_FirstBytes;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
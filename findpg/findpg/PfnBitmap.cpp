@@ -0,0 +1,94 @@
+//
+// This module implements a class responsible for remembering a set of page
+// frame numbers.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "PfnBitmap.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+PfnBitmap::PfnBitmap()
+    : m_LastChunkIndex(0)
+    , m_LastChunk(nullptr)
+{
+}
+
+
+bool PfnBitmap::TestAndSet(
+    __in ULONG64 Pfn)
+{
+    auto& word = GetWord(Pfn);
+    const auto bit = 1ULL << (Pfn % 64);
+    const auto wasSet = (word & bit) != 0;
+    word |= bit;
+    return wasSet;
+}
+
+
+void PfnBitmap::Clear(
+    __in ULONG64 Pfn)
+{
+    GetWord(Pfn) &= ~(1ULL << (Pfn % 64));
+}
+
+
+// Returns the word containing the bit for Pfn, allocating its chunk as needed
+std::uint64_t& PfnBitmap::GetWord(
+    __in ULONG64 Pfn)
+{
+    const auto chunkIndex = Pfn >> CHUNK_SHIFT;
+    if (!m_LastChunk || chunkIndex != m_LastChunkIndex)
+    {
+        auto& chunk = m_Chunks[chunkIndex];
+        if (!chunk)
+        {
+            chunk.reset(new Chunk());
+            chunk->fill(0);
+        }
+        m_LastChunkIndex = chunkIndex;
+        m_LastChunk = chunk.get();
+    }
+
+    const auto bitIndex = Pfn & ((1ULL << CHUNK_SHIFT) - 1);
+    return (*m_LastChunk)[static_cast<SIZE_T>(bitIndex / 64)];
+}
+
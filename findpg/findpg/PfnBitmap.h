@@ -0,0 +1,85 @@
+//
+// This module declears a class responsible for remembering a set of page
+// frame numbers.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <unordered_map>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// A bitmap of page frame numbers allocated in chunks of 128MB of physical
+// memory. Chunks are kept in a hash table so that sparse high physical
+// addresses, which can be anywhere below 4PB, require neither a bitmap nor a
+// table of chunks covering the entire physical address space.
+class PfnBitmap
+{
+public:
+    PfnBitmap();
+
+    // Sets the bit for Pfn and returns its previous state
+    bool TestAndSet(
+        __in ULONG64 Pfn);
+
+    // Clears the bit for Pfn set by TestAndSet()
+    void Clear(
+        __in ULONG64 Pfn);
+
+private:
+    std::uint64_t& GetWord(
+        __in ULONG64 Pfn);
+
+    static const ULONG CHUNK_SHIFT = 15;
+    typedef std::array<std::uint64_t, (1 << CHUNK_SHIFT) / 64> Chunk;
+
+    std::unordered_map<ULONG64, std::unique_ptr<Chunk>> m_Chunks;
+
+    // The chunk used last, as consecutive pages are mostly in the same chunk
+    ULONG64 m_LastChunkIndex;
+    Chunk* m_LastChunk;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,108 @@
+//
+// This module implements layouts of POOL_TRACKER_BIG_PAGES for each family
+// of Windows kernels.
+//
+// To support a new layout, define a new traits class with the same members
+// as the existing ones and add it to the dispatch in
+// FindPgPagesFromNonPagedPool(). The traits are selected once per scan by the
+// size of nt!_POOL_TRACKER_BIG_PAGES, and a walker specialized for each of
+// them is instantiated so that the per-entry loop has no layout checks.
+//
+#pragma once
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Windows Vista and later kernels without the ProcessBilled field
+struct PoolTrackerBigPagesV1
+{
+    typedef struct _ENTRY
+    {
+        ULONG64 Va;
+        ULONG Key;
+        ULONG PoolType;
+        ULONG64 NumberOfBytes;
+    } ENTRY;
+
+    static const ULONG EntrySize = 0x18;
+
+    static ULONG64 GetVa(const ENTRY& Entry) { return Entry.Va; }
+    static ULONG GetKey(const ENTRY& Entry) { return Entry.Key; }
+    static ULONG64 GetSize(const ENTRY& Entry) { return Entry.NumberOfBytes; }
+};
+C_ASSERT(sizeof(PoolTrackerBigPagesV1::ENTRY)
+    == PoolTrackerBigPagesV1::EntrySize);
+
+
+// Windows 10 kernels with the ProcessBilled field
+struct PoolTrackerBigPagesV2
+{
+    typedef struct _ENTRY
+    {
+        ULONG64 Va;
+        ULONG Key;
+        ULONG Pattern : 8;
+        ULONG PoolType : 12;
+        ULONG SlushSize : 12;
+        ULONG64 NumberOfBytes;
+        ULONG64 ProcessBilled;
+    } ENTRY;
+
+    static const ULONG EntrySize = 0x20;
+
+    static ULONG64 GetVa(const ENTRY& Entry) { return Entry.Va; }
+    static ULONG GetKey(const ENTRY& Entry) { return Entry.Key; }
+    static ULONG64 GetSize(const ENTRY& Entry) { return Entry.NumberOfBytes; }
+};
+C_ASSERT(sizeof(PoolTrackerBigPagesV2::ENTRY)
+    == PoolTrackerBigPagesV2::EntrySize);
+
+
+// Layout independent representation of a big pool entry
+struct BigPoolEntry
+{
+    ULONG64 Va;
+    ULONG Key;
+    ULONG64 Size;    // InBytes
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -28,32 +28,78 @@
 //
 
 Progress::Progress(
-    __in ExtExtension* Ext)
-    : m_Ext(Ext)
-    , m_Progress(0)
+    __in ScanProvider* Provider,
+    __in const char* Phase,
+    __in const char* Unit,
+    __in std::uint64_t Total)
+    : m_Provider(Provider)
+    , m_Phase(Phase)
+    , m_Unit(Unit)
+    , m_Done(0)
+    , m_Total(Total)
+    , m_StartTime(GetTickCount64())
+    , m_LastDisplayTime(m_StartTime)
 {
 }
 
 
 Progress::~Progress()
 {
-    m_Ext->Out("\n");
+    // Always display the final state
+    Display(GetTickCount64());
 }
 
 
 Progress& Progress::operator++()
 {
-    if (m_Progress == 70)
+    return *this += 1;
+}
+
+
+Progress& Progress::operator+=(
+    __in std::uint64_t Done)
+{
+    m_Done += Done;
+
+    // Calling the debugger engine is expensive, especially over a remote
+    // session, so only a few updates are made regardless of the amount of work
+    const auto now = GetTickCount64();
+    if (now - m_LastDisplayTime >= REFRESH_INTERVAL_MS)
     {
-        m_Progress = 0;
-        m_Ext->Out("\n");
+        Display(now);
     }
-    ++m_Progress;
-    m_Ext->Out(".");
     return *this;
 }
 
 
+// Updates the estimated total amount of work when it is narrowed after the
+// progress has started, for example, by sampling in Phase 1
+void Progress::SetTotal(
+    __in std::uint64_t Total)
+{
+    m_Total = Total;
+}
+
+
+// Displays progress in a line like this:
+//   Phase 2:  37.5% (   120 /    320 directories,     41 directories/s, ETA 00:00:04)
+void Progress::Display(
+    __in std::uint64_t Now)
+{
+    m_LastDisplayTime = Now;
+
+    const auto done = (m_Done < m_Total) ? m_Done : m_Total;
+    const auto percentage = (m_Total) ? done * 100.0 / m_Total : 100.0;
+    const auto elapsedMs = Now - m_StartTime;
+    const auto throughput = (elapsedMs) ? done * 1000 / elapsedMs : done;
+    const auto remainingSec = (throughput) ? (m_Total - done) / throughput : 0;
+    m_Provider->Out("%s: %5.1f%% (%8I64u / %8I64u %s, %6I64u %s/s,"
+        " ETA %02I64u:%02I64u:%02I64u)\n",
+        m_Phase, percentage, done, m_Total, m_Unit, throughput, m_Unit,
+        remainingSec / 3600, (remainingSec / 60) % 60, remainingSec % 60);
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // prototypes
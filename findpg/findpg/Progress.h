@@ -8,9 +8,10 @@
 
 // Other external headers
 // Windows headers
-#include <engextcpp.hpp>
+#include <Windows.h>
 
 // Original headers
+#include "ScanProvider.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -30,19 +31,41 @@
 // types
 //
 
+// Tracks work done against an estimated total and displays a phase name,
+// percentage, throughput and ETA at most once per REFRESH_INTERVAL_MS.
 class Progress
 {
 public:
     Progress(
-        __in ExtExtension* Ext);
+        __in ScanProvider* Provider,
+        __in const char* Phase,
+        __in const char* Unit,
+        __in std::uint64_t Total);
 
     ~Progress();
 
     Progress& operator++();
 
+    Progress& operator+=(
+        __in std::uint64_t Done);
+
+    void SetTotal(
+        __in std::uint64_t Total);
+
 private:
-    ExtExtension* m_Ext;
-    std::uint64_t m_Progress;
+    void Display(
+        __in std::uint64_t Now);
+
+    // Minimum interval between two updates of display in milliseconds
+    static const std::uint64_t REFRESH_INTERVAL_MS = 1000;
+
+    ScanProvider* m_Provider;
+    const char* m_Phase;
+    const char* m_Unit;
+    std::uint64_t m_Done;
+    std::uint64_t m_Total;
+    std::uint64_t m_StartTime;
+    std::uint64_t m_LastDisplayTime;
 };
 
 
@@ -0,0 +1,124 @@
+//
+// This module implements functions responsible for selecting page table
+// entries with given attributes from an entire page table at once.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+#include <emmintrin.h>
+#include <intrin.h>
+
+// Other external headers
+// Windows headers
+// Original headers
+#include "PteFilter.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+// Compares two entries at a time with SSE2. As SSE2 has no 64bit comparison,
+// an entry matches when both of its 32bit halves match.
+PteMatchBitmap GetPteMatchBitmap(
+    __in const std::array<HARDWARE_PTE, 512>& Ptes,
+    __in ULONG64 Mask,
+    __in ULONG64 Expected)
+{
+    C_ASSERT(sizeof(HARDWARE_PTE) * 2 == sizeof(__m128i));
+    const auto mask = _mm_set1_epi64x(static_cast<LONG64>(Mask));
+    const auto expected = _mm_set1_epi64x(static_cast<LONG64>(Expected));
+    const auto entries = reinterpret_cast<const __m128i*>(Ptes.data());
+
+    PteMatchBitmap bitmap = {};
+    for (SIZE_T i = 0; i < Ptes.size() / 2; ++i)
+    {
+        const auto masked = _mm_and_si128(_mm_loadu_si128(entries + i), mask);
+        const auto equal32 = _mm_cmpeq_epi32(masked, expected);
+        const auto equal64 = _mm_and_si128(equal32,
+            _mm_shuffle_epi32(equal32, _MM_SHUFFLE(2, 3, 0, 1)));
+        const auto bits = static_cast<std::uint64_t>(
+            _mm_movemask_pd(_mm_castsi128_pd(equal64)));
+        bitmap[i / 32] |= bits << ((i % 32) * 2);
+    }
+    return bitmap;
+}
+
+
+bool FindNextSetBit(
+    __in const PteMatchBitmap& Bitmap,
+    __inout SIZE_T& Index)
+{
+    for (auto word = Index / 64; word < Bitmap.size(); ++word)
+    {
+        auto bits = Bitmap[word];
+        if (word == Index / 64)
+        {
+            bits &= ~0ULL << (Index % 64);
+        }
+        unsigned long bit = 0;
+        if (_BitScanForward64(&bit, bits))
+        {
+            Index = word * 64 + bit;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+ULONG CountSetBits(
+    __in std::uint64_t Bits)
+{
+    ULONG count = 0;
+    while (Bits)
+    {
+        Bits &= Bits - 1;
+        count++;
+    }
+    return count;
+}
+
+
+ULONG CountSetBits(
+    __in const PteMatchBitmap& Bitmap)
+{
+    ULONG count = 0;
+    for (auto bits : Bitmap)
+    {
+        count += CountSetBits(bits);
+    }
+    return count;
+}
+
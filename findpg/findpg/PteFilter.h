@@ -0,0 +1,81 @@
+//
+// This module declears functions responsible for selecting page table entries
+// with given attributes from an entire page table at once.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <array>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "pte.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+// Bits of HARDWARE_PTE used as Mask and Expected of GetPteMatchBitmap()
+static const auto PTE_VALID      = 1ULL << 0;
+static const auto PTE_WRITE      = 1ULL << 1;
+static const auto PTE_LARGE_PAGE = 1ULL << 7;
+static const auto PTE_NO_EXECUTE = 1ULL << 63;
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Bit N corresponds to the Nth entry of a page table
+typedef std::array<std::uint64_t, 8> PteMatchBitmap;
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+// Returns a bitmap where bit N is set when (Ptes[N] & Mask) == Expected
+PteMatchBitmap GetPteMatchBitmap(
+    __in const std::array<HARDWARE_PTE, 512>& Ptes,
+    __in ULONG64 Mask,
+    __in ULONG64 Expected);
+
+// Advances Index to the first set bit at or after Index. Returns false when
+// there is no such bit.
+bool FindNextSetBit(
+    __in const PteMatchBitmap& Bitmap,
+    __inout SIZE_T& Index);
+
+// Returns the number of set bits in the value
+ULONG CountSetBits(
+    __in std::uint64_t Bits);
+
+ULONG CountSetBits(
+    __in const PteMatchBitmap& Bitmap);
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
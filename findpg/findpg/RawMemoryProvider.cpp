@@ -0,0 +1,99 @@
+//
+// This module implements a class responsible for giving the scanner access to
+// a file holding guest physical memory of a running virtual machine as is.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "RawMemoryProvider.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+RawMemoryProvider::RawMemoryProvider(
+    __in ScanProvider& Output,
+    __in const std::string& Path,
+    __in ULONG64 DirectoryTableBase,
+    __in ULONG64 BelowFourGbBytes,
+    __in ULONG64 MaximumMappedBytes)
+    : GuestMemoryProvider(Output)
+    , m_File(Path, true, MaximumMappedBytes)   // The hypervisor writes to it
+    , m_BelowFourGbBytes(BelowFourGbBytes)
+{
+    m_DirectoryTableBase = DirectoryTableBase;
+    m_IsLive = true;
+    if (!m_BelowFourGbBytes)
+    {
+        if (m_File.GetSize() >= MINIMUM_SPLIT_RAM_SIZE)
+        {
+            throw std::runtime_error(Path + " may have RAM above 4GB. Give "
+                "the size of RAM below 4GB with -lowmem.");
+        }
+        m_BelowFourGbBytes = m_File.GetSize();
+    }
+    if (m_BelowFourGbBytes > FOUR_GB)
+    {
+        throw std::runtime_error("-lowmem is larger than 4GB.");
+    }
+}
+
+
+// Converts the guest physical address into an offset in the file, skipping
+// the hole below 4GB
+const std::uint8_t* RawMemoryProvider::GetPhysical(
+    __in ULONG64 PhysicalAddress,
+    __out ULONG64& Available)
+{
+    Available = 0;
+    if (PhysicalAddress >= FOUR_GB)
+    {
+        return m_File.Map(m_BelowFourGbBytes + (PhysicalAddress - FOUR_GB),
+            Available);
+    }
+    if (PhysicalAddress >= m_BelowFourGbBytes)
+    {
+        return nullptr;
+    }
+    const auto data = m_File.Map(PhysicalAddress, Available);
+    if (data && Available > m_BelowFourGbBytes - PhysicalAddress)
+    {
+        Available = m_BelowFourGbBytes - PhysicalAddress;
+    }
+    return data;
+}
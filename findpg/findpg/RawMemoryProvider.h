@@ -0,0 +1,94 @@
+//
+// This module declears a class responsible for giving the scanner access to
+// a file holding guest physical memory of a running virtual machine as is.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <string>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "GuestMemoryProvider.h"
+#include "MappedFile.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Reads guest memory from a file backing RAM of a virtual machine, such as
+// memory-backend-file of QEMU. The file is mapped read-only through a bounded
+// number of windows while the guest keeps running and writing to it, so each
+// page is translated again after it is copied.
+//
+// RAM in the file is contiguous, but guest physical addresses are not: RAM
+// above BelowFourGbBytes (below_4g_mem_size of QEMU) is placed at 4GB to leave
+// a hole for PCI devices. A guest physical address at or above 4GB is at
+// offset BelowFourGbBytes + (address - 4GB) in the file.
+class RawMemoryProvider : public GuestMemoryProvider
+{
+public:
+    // BelowFourGbBytes is the size of RAM below 4GB, or 0 when all RAM is
+    // below the hole. Throws std::runtime_error when the file cannot be used,
+    // or is large enough to be split but BelowFourGbBytes is 0.
+    RawMemoryProvider(
+        __in ScanProvider& Output,
+        __in const std::string& Path,
+        __in ULONG64 DirectoryTableBase,
+        __in ULONG64 BelowFourGbBytes,
+        __in ULONG64 MaximumMappedBytes);
+
+    const MappedFile& GetFile() const { return m_File; }
+
+protected:
+    virtual const std::uint8_t* GetPhysical(
+        __in ULONG64 PhysicalAddress,
+        __out ULONG64& Available);
+
+private:
+    // The smallest size of RAM split by QEMU (the q35 machine type). RAM of
+    // the i440fx machine type is split above 3.5GB.
+    static const ULONG64 MINIMUM_SPLIT_RAM_SIZE = 0xb0000000;
+
+    static const ULONG64 FOUR_GB = 0x100000000;
+
+    MappedFile m_File;
+    ULONG64 m_BelowFourGbBytes;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
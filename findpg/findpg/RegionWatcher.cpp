@@ -0,0 +1,100 @@
+//
+// This module implements a class responsible for tracking PatchGuard regions
+// found by repeated scans of a running target.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "RegionWatcher.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+void RegionWatcher::Update(
+    __in const ScanResult& Result,
+    __out std::vector<Region>& Added,
+    __out std::vector<Region>& Removed)
+{
+    Added.clear();
+    Removed.clear();
+
+    RegionMap current;
+    for (const auto& n : Result.BigPagePool)
+    {
+        current[std::make_tuple(std::get<0>(n).Va, "BigPagePool")] =
+            std::get<0>(n).Size;
+    }
+    for (const auto& n : Result.Independent)
+    {
+        current[std::make_tuple(std::get<0>(n), "Independent")] =
+            std::get<1>(n);
+    }
+    for (const auto& n : Result.LargePage)
+    {
+        current[std::make_tuple(std::get<0>(n), "LargePage")] =
+            std::get<1>(n);
+    }
+    for (const auto& n : Result.Timer)
+    {
+        current[std::make_tuple(std::get<0>(n), "Timer")] = std::get<1>(n);
+    }
+
+    for (const auto& n : current)
+    {
+        if (!m_Regions.count(n.first))
+        {
+            const Region region = {
+                std::get<1>(n.first), std::get<0>(n.first), n.second,
+            };
+            Added.push_back(region);
+        }
+    }
+    for (const auto& n : m_Regions)
+    {
+        if (!current.count(n.first))
+        {
+            const Region region = {
+                std::get<1>(n.first), std::get<0>(n.first), n.second,
+            };
+            Removed.push_back(region);
+        }
+    }
+    m_Regions.swap(current);
+}
+
@@ -0,0 +1,84 @@
+//
+// This module declears a class responsible for tracking PatchGuard regions
+// found by repeated scans of a running target.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <map>
+#include <tuple>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "Scanner.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Keeps regions found by the previous scan and compares them with those of
+// the next scan. Regions of all kinds of a scan result are tracked, and a
+// region is identified by its kind and base address.
+class RegionWatcher
+{
+public:
+    struct Region
+    {
+        const char* Kind;   // "BigPagePool", "Independent", "LargePage" or
+                            // "Timer"
+        ULONG64 Base;
+        ULONG64 Size;
+    };
+
+    // Replaces tracked regions with those in Result. Regions not found by the
+    // previous scan are returned in Added, and regions no longer found are
+    // returned in Removed, both sorted by their base addresses.
+    void Update(
+        __in const ScanResult& Result,
+        __out std::vector<Region>& Added,
+        __out std::vector<Region>& Removed);
+
+    SIZE_T GetNumberOfRegions() const { return m_Regions.size(); }
+
+private:
+    typedef std::map<std::tuple<ULONG64, const char*>, ULONG64> RegionMap;
+
+    RegionMap m_Regions;    // Sizes keyed by base addresses and kinds
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
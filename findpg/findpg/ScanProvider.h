@@ -0,0 +1,181 @@
+//
+// This module declears an interface responsible for giving the scanner access
+// to a target.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdarg>
+#include <cstdio>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Provides the scanner with memory and symbols of a target and a place to
+// display messages. The debugger extension implements it on top of the
+// debugger engine, and the C API on top of callbacks given by a caller.
+class ScanProvider
+{
+public:
+    virtual ~ScanProvider() {}
+
+    // Reads virtual memory of the target. ReadBytes receives the number of
+    // bytes read when it is not nullptr. Returns false only when the first
+    // byte cannot be read; otherwise, a part of the range may be read.
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes) = 0;
+
+    // Reads a pointer of the target. Only 64bit targets are supported.
+    virtual bool ReadPointer(
+        __in ULONG64 Address,
+        __out ULONG64& Value)
+    {
+        Value = 0;
+        ULONG readBytes = 0;
+        return ReadVirtual(Address, &Value, sizeof(Value), &readBytes) &&
+            readBytes == sizeof(Value);
+    }
+
+    // Returns the next address after Address whose readability may differ
+    // from that of Address, for example, the end of a range missing in a
+    // dump file. Returns false when it is not known.
+    virtual bool GetNextDifferentlyValidOffset(
+        __in ULONG64 Address,
+        __out ULONG64& NextAddress)
+    {
+        UNREFERENCED_PARAMETER(Address);
+        NextAddress = 0;
+        return false;
+    }
+
+    // Resolves an address of a symbol such as "nt!PoolBigPageTable"
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset) = 0;
+
+    // Returns a size of a type such as "nt!_POOL_TRACKER_BIG_PAGES". Returns
+    // false when type information is not available.
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size) = 0;
+
+    // Returns an offset of a field such as "TimerTable" in a type such as
+    // "nt!_KPRCB". Returns false when type information is not available.
+    virtual bool GetFieldOffset(
+        __in const char* Type,
+        __in const char* Field,
+        __out ULONG& Offset)
+    {
+        UNREFERENCED_PARAMETER(Type);
+        UNREFERENCED_PARAMETER(Field);
+        Offset = 0;
+        return false;
+    }
+
+    // Returns the number of levels of page tables and the index of the
+    // self-map in the top-level table when the provider knows them without
+    // symbols. Returns false otherwise.
+    virtual bool GetPagingMode(
+        __out ULONG& NumberOfLevels,
+        __out ULONG64& SelfMapIndex)
+    {
+        NumberOfLevels = 0;
+        SelfMapIndex = 0;
+        return false;
+    }
+
+    // Returns the base address, time stamp and size of a loaded image such as
+    // "nt". Returns false when it is not known.
+    virtual bool GetModuleIdentity(
+        __in const char* Module,
+        __out ULONG64& Base,
+        __out ULONG& TimeDateStamp,
+        __out ULONG& SizeOfImage)
+    {
+        UNREFERENCED_PARAMETER(Module);
+        Base = 0;
+        TimeDateStamp = 0;
+        SizeOfImage = 0;
+        return false;
+    }
+
+    // Displays a message
+    virtual void Write(
+        __in const char* Text) = 0;
+
+    // Displays an error message
+    virtual void WriteError(
+        __in const char* Text)
+    {
+        Write(Text);
+    }
+
+    // Formats and displays a message
+    void Out(
+        __in const char* Format,
+        ...)
+    {
+        va_list args;
+        va_start(args, Format);
+        char text[1024];
+        _vsnprintf_s(text, _TRUNCATE, Format, args);
+        va_end(args);
+        Write(text);
+    }
+
+    // Formats and displays an error message
+    void Err(
+        __in const char* Format,
+        ...)
+    {
+        va_list args;
+        va_start(args, Format);
+        char text[1024];
+        _vsnprintf_s(text, _TRUNCATE, Format, args);
+        va_end(args);
+        WriteError(text);
+    }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,120 @@
+//
+// This module implements functions responsible for displaying a summary of a
+// scan.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "ScanSummary.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+// Displays per-phase timings and failures. The last line is in a single-line
+// key=value form so that results of many dumps processed by a script can be
+// aggregated with simple text tools.
+void DisplaySummary(
+    __in ScanProvider& Output,
+    __in const std::vector<PhaseStatistics>& Statistics,
+    __in const PageTableSnapshot& PageTables)
+{
+    Output.Out("\n");
+    SIZE_T numberOfFailures = 0;
+    auto isPartial = false;
+    for (const auto& phase : Statistics)
+    {
+        if (phase.IsSkipped)
+        {
+            Output.Out("%-22s: skipped\n", phase.Name);
+            continue;
+        }
+        Output.Out("%-22s: %5Iu found, %8.1f sec, %6Iu read failures, %s\n",
+            phase.Name, phase.NumberOfFound,
+            phase.ElapsedMilliseconds / 1000.0,
+            phase.NumberOfReadFailures,
+            phase.Error.empty() ? "OK" : phase.Error.c_str());
+        if (!phase.Error.empty())
+        {
+            numberOfFailures++;
+        }
+        if (phase.NumberOfUnits)
+        {
+            Output.Out("%-22s  %5.1f%% of %I64u %s covered%s\n", "",
+                phase.NumberOfUnitsDone * 100.0 / phase.NumberOfUnits,
+                phase.NumberOfUnits, phase.UnitName,
+                phase.IsBudgetExhausted
+                    ? " (stopped as the time budget ran out)" : "");
+        }
+        if (phase.IsSampled)
+        {
+            Output.Out("%-22s  estimated %.1f regions in total"
+                " (95%% CI %.1f - %.1f)\n", "", phase.Estimate.Total,
+                phase.Estimate.Lower, phase.Estimate.Upper);
+        }
+        if (phase.NumberOfPrunedRegions)
+        {
+            Output.Out("%-22s  %Iu regions (%Iu GB) skipped by system VA"
+                " type\n", "", phase.NumberOfPrunedRegions,
+                phase.NumberOfPrunedRegions * 512);
+        }
+        if (phase.NumberOfLargePages)
+        {
+            Output.Out("%-22s  %Iu large pages examined in %.1f sec\n", "",
+                phase.NumberOfLargePages,
+                phase.LargePageMilliseconds / 1000.0);
+        }
+        if (phase.IsBudgetExhausted)
+        {
+            isPartial = true;
+        }
+    }
+    Output.Out("Page table snapshot   : %5Iu tables read in this session"
+        " with %Iu batched reads, %Iu valid entries cached\n",
+        PageTables.GetNumberOfFetches(),
+        PageTables.GetNumberOfBatchedReads(),
+        PageTables.GetNumberOfCachedEntries());
+    Output.Out("FINDPG_SUMMARY BigPagePool=%Iu Independent=%Iu Phase1Ms=%I64u"
+        " Phase2Ms=%I64u Failures=%Iu Partial=%d Timer=%Iu Phase0Ms=%I64u\n",
+        Statistics[1].NumberOfFound, Statistics[2].NumberOfFound,
+        Statistics[1].ElapsedMilliseconds, Statistics[2].ElapsedMilliseconds,
+        numberOfFailures, isPartial, Statistics[0].NumberOfFound,
+        Statistics[0].ElapsedMilliseconds);
+}
+
+
@@ -0,0 +1,62 @@
+//
+// This module declears functions responsible for displaying a summary of a
+// scan.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "PageTableSnapshot.h"
+#include "ScanProvider.h"
+#include "Scanner.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+// Displays per-phase timings and failures followed by a FINDPG_SUMMARY line.
+// It is shared by !findpg and findpgscan so that scripts aggregating the line
+// work with both of them.
+void DisplaySummary(
+    __in ScanProvider& Output,
+    __in const std::vector<PhaseStatistics>& Statistics,
+    __in const PageTableSnapshot& PageTables);
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,1695 @@
+//
+// This module implements a class responsible for finding PatchGuard pages
+// through a ScanProvider.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "Scanner.h"
+#include "pte.h"
+#include "Progress.h"
+#include "PfnBitmap.h"
+#include "PteFilter.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+// The number of PML4 entries in the system half of the address space, each of
+// which has its own system VA type
+static const SIZE_T NUMBER_OF_SYSTEM_REGIONS = 256;
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// A page directory to analyze in Phase 2 as a unit of work
+struct DirectoryUnit
+{
+    ULONG64 PpeIndex;   // Index of the PPE referencing this directory
+    ULONG NumberOfPageTables;
+    ULONG Priority;     // Higher is analyzed earlier
+    ULONG Stratum;      // 0 when it is in the PML4 entry of NonPagedPool
+};
+
+
+// Types of system regions (nt!_MI_SYSTEM_VA_TYPE). Values up to DriverImages
+// are the same since Windows 8.1, and the rest were added by Windows 10 1709.
+// Types unknown to this list may be added by later versions and are walked.
+enum class SystemVaType : std::uint8_t
+{
+    Unused,
+    SessionSpace,
+    ProcessSpace,       // Includes the page table self-map
+    BootLoaded,
+    PfnDatabase,
+    NonPagedPool,
+    PagedPool,
+    SpecialPoolPaged,
+    SystemCache,
+    SystemPtes,
+    Hal,
+    SessionGlobalSpace,
+    DriverImages,
+    SystemPtesLarge,
+    KernelStacks,
+    SecureNonPagedPool,
+    KernelShadowStacks,
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+ULONG GetNumberOfDistinctiveNumbers(
+    void* Addr,
+    SIZE_T Size);
+
+ULONG GetRamdomness(
+    void* Addr,
+    SIZE_T Size);
+
+ULONG64 DecodeTimerDpc(
+    ULONG64 Timer,
+    ULONG64 EncodedDpc,
+    ULONG64 WaitNever,
+    ULONG64 WaitAlways);
+
+bool IsPrunableSystemVaType(
+    std::uint8_t Type);
+
+const char* GetSystemVaTypeName(
+    std::uint8_t Type);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+Scanner::Scanner(
+    __in ScanProvider& Provider,
+    __in PageTableSnapshot& PageTables,
+    __in const ScanOptions& Options)
+    : m_Provider(Provider)
+    , m_PageTables(PageTables)
+    , m_Statistics(nullptr)
+    , m_Deadline(Options.Deadline)
+    , m_IsCancelled(Options.IsCancelled)
+    , m_TimersOnly(Options.TimersOnly)
+    , m_Patterns(Options.Patterns)
+    , m_SampleFraction(Options.SampleFraction)
+    , m_Seed(Options.Seed)
+    , m_NumberOfLevels(FourLevelPaging::NumberOfLevels)
+    , m_SelfMapIndex(CLASSIC_SELF_MAP_INDEX)
+    , m_PteBase(0)
+    , m_PdeBase(0)
+    , m_VirtualAddressMask(0)
+    , m_DefaultNonPagedPoolStart(0)
+    , m_NumberOfSearchedBytes(0)
+    , m_SearchTicks(0)
+{
+}
+
+
+// Collects PatchGuard pages referenced by timers, and then, from NonPagedPool
+// and independent pages. A failure of one phase does not prevent the other
+// phases from running so that as much as possible is reported for a broken
+// target.
+ScanResult Scanner::Scan()
+{
+    ScanResult result;
+    result.Statistics.resize(3, PhaseStatistics());
+    result.Statistics[0].Name = "Phase 0 (Timer)";
+    result.Statistics[1].Name = "Phase 1 (BigPagePool)";
+    result.Statistics[2].Name = "Phase 2 (Independent)";
+    DetectPagingMode();
+
+    // Timers are analyzed first as it takes only seconds. Unless it is
+    // requested explicitly, it is skipped silently when type information is
+    // not available.
+    ULONG offset = 0;
+    if (m_TimersOnly ||
+        m_Provider.GetFieldOffset("nt!_KPRCB", "TimerTable", offset))
+    {
+        result.Timer = RunPhase(result.Statistics[0],
+            [this]() { return FindPgPagesFromTimers(); });
+        m_Provider.Out("Phase 0 analysis has been done.\n");
+    }
+    else
+    {
+        result.Statistics[0].IsSkipped = true;
+    }
+    if (m_TimersOnly)
+    {
+        result.Statistics[1].IsSkipped = true;
+        result.Statistics[2].IsSkipped = true;
+        return result;
+    }
+
+    result.BigPagePool = RunPhase(result.Statistics[1],
+        [this]() { return FindPgPagesFromNonPagedPool(); });
+    m_Provider.Out("Phase 1 analysis has been done.\n");
+    result.Independent = RunPhase(result.Statistics[2],
+        [this, &result]()
+    {
+        return FindPgPagesFromIndependentPages(result.LargePage);
+    });
+    result.Statistics[2].NumberOfFound += result.LargePage.size();
+    result.Decrypted.swap(m_Decrypted);
+    m_Provider.Out("Phase 2 analysis has been done.\n");
+
+    // Sort data according to its base addresses
+    std::sort(result.BigPagePool.begin(), result.BigPagePool.end(), [](
+        const decltype(result.BigPagePool)::value_type& Lhs,
+        const decltype(result.BigPagePool)::value_type& Rhs)
+    {
+        return std::get<0>(Lhs).Va < std::get<0>(Rhs).Va;
+    });
+    std::sort(result.Independent.begin(), result.Independent.end(), [](
+        const decltype(result.Independent)::value_type& Lhs,
+        const decltype(result.Independent)::value_type& Rhs)
+    {
+        return std::get<0>(Lhs) < std::get<0>(Rhs);
+    });
+    std::sort(result.LargePage.begin(), result.LargePage.end(), [](
+        const decltype(result.LargePage)::value_type& Lhs,
+        const decltype(result.LargePage)::value_type& Rhs)
+    {
+        return std::get<0>(Lhs) < std::get<0>(Rhs);
+    });
+    return result;
+}
+
+
+// Runs one analysis phase while measuring its time and catching its failure
+template <typename PhaseFunction>
+auto Scanner::RunPhase(
+    __inout PhaseStatistics& Statistics,
+    __in PhaseFunction Phase) -> decltype(Phase())
+{
+    decltype(Phase()) found;
+    m_Statistics = &Statistics;
+    const auto start = GetTickCount64();
+    try
+    {
+        found = Phase();
+    }
+    catch (std::exception& e)
+    {
+        Statistics.Error = e.what();
+        m_Provider.Err("%s failed: %s\n", Statistics.Name, e.what());
+    }
+    Statistics.ElapsedMilliseconds = GetTickCount64() - start;
+    Statistics.NumberOfFound = found.size();
+    m_Statistics = nullptr;
+    return found;
+}
+
+
+// Collects PatchGuard pages referenced by timers. PatchGuard schedules its
+// checks with timers whose DPCs carry contexts, so pages of a KTIMER, a KDPC
+// and a DeferredContext, and contiguous random RWX pages before them are
+// examined instead of the entire address space. A region reported by this
+// phase starts at the page having a size header covering the referenced
+// address, or the lowest random page when it has no such a header.
+std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo, ULONG64>>
+Scanner::FindPgPagesFromTimers()
+{
+    const auto references = GetTimerReferences();
+
+    // Build classification stages
+    typedef CandidatePipeline<Candidate> Pipeline;
+    Pipeline pipeline;
+    pipeline.AddStage("Attribute", Pipeline::StageKind::RequiresRead,
+        [this](Candidate& C)
+    {
+        // Filter by the page protection
+        return IsPatchGuardPageAttribute(C.Va);
+    });
+    const auto readStage = pipeline.AddStage("Read",
+        Pipeline::StageKind::RequiresRead,
+        [this](Candidate& C)
+    {
+        C.IsRead = ReadContents(C.Va, C.Contents.data(),
+            static_cast<ULONG>(C.Contents.size()));
+        return C.IsRead;
+    });
+    AddContentStages(pipeline, readStage);
+
+    // Verdicts of examined pages. A walk reaching a page accepted by an
+    // earlier walk is a part of the region found by it.
+    std::unordered_map<ULONG64, bool> examinedPages;
+    std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo, ULONG64>> found;
+    for (const auto& reference : references)
+    {
+        if (IsBudgetExhausted())
+        {
+            break;
+        }
+        const auto timer = std::get<0>(reference);
+        const auto address = std::get<1>(reference);
+        const auto page = address & ~0xfffull;
+
+        // Walk back while pages look random and are RWX
+        ULONG64 regionBase = 0;
+        ULONG64 regionSize = 0;
+        RandomnessInfo randomness = {};
+        for (auto va = page; page - va < MAXIMUM_REGION_SIZE; va -= 0x1000)
+        {
+            const auto examined = examinedPages.find(va);
+            if (examined != examinedPages.end())
+            {
+                if (examined->second)
+                {
+                    regionBase = 0;
+                }
+                break;
+            }
+            Candidate candidate;
+            candidate.Va = va;
+            candidate.Size = 0;
+            candidate.Key = 0;
+            candidate.IsRead = false;
+            const auto accepted = pipeline.Run(candidate);
+            examinedPages.emplace(va, accepted);
+            if (!accepted)
+            {
+                break;
+            }
+            regionBase = va;
+            regionSize = page + 0x1000 - va;
+            randomness = candidate.Randomness;
+
+            // Stop at the head of an allocation covering the address
+            const auto size = *reinterpret_cast<ULONG64*>(
+                candidate.Contents.data());
+            if (MINIMUM_REGION_SIZE <= size && size <= MAXIMUM_REGION_SIZE &&
+                va + size > address)
+            {
+                regionSize = size;
+                break;
+            }
+        }
+        if (regionBase)
+        {
+            found.emplace_back(regionBase, static_cast<SIZE_T>(regionSize),
+                randomness, timer);
+        }
+    }
+    pipeline.DisplayStatistics(m_Provider);
+    m_Provider.Out("  %Iu addresses referenced by timers, %Iu pages examined\n",
+        references.size(), examinedPages.size());
+    return found;
+}
+
+
+// Returns pairs of a KTIMER and an address referenced by it, that is, the
+// KTIMER itself, its KDPC and DeferredContext of the KDPC, for all timers
+// in timer tables of all processors.
+std::vector<std::tuple<ULONG64, ULONG64>> Scanner::GetTimerReferences()
+{
+    ULONG64 kiProcessorBlock = 0;
+    if (!m_Provider.GetSymbolOffset("nt!KiProcessorBlock", kiProcessorBlock))
+    {
+        throw std::runtime_error("nt!KiProcessorBlock could not be found.");
+    }
+    ULONG64 offset = 0;
+    ULONG numberOfProcessors = 0;
+    ULONG readBytes = 0;
+    if (!m_Provider.GetSymbolOffset("nt!KeNumberProcessors", offset) ||
+        !m_Provider.ReadVirtual(offset, &numberOfProcessors,
+            sizeof(numberOfProcessors), &readBytes) ||
+        readBytes != sizeof(numberOfProcessors))
+    {
+        throw std::runtime_error("nt!KeNumberProcessors could not be read.");
+    }
+    if (numberOfProcessors > MAXIMUM_PROCESSORS)
+    {
+        numberOfProcessors = MAXIMUM_PROCESSORS;
+    }
+
+    // DPCs of timers are encoded with these values on Windows 8.1 and later.
+    // Without them, DPCs are assumed to be stored as they are.
+    ULONG64 kiWaitNever = 0;
+    ULONG64 kiWaitAlways = 0;
+    const auto isEncoded =
+        m_Provider.GetSymbolOffset("nt!KiWaitNever", offset) &&
+        m_Provider.ReadPointer(offset, kiWaitNever) &&
+        m_Provider.GetSymbolOffset("nt!KiWaitAlways", offset) &&
+        m_Provider.ReadPointer(offset, kiWaitAlways);
+
+    // Layouts of timer related structures
+    const auto timerTableOffset = GetRequiredFieldOffset(
+        "nt!_KPRCB", "TimerTable");
+    const auto timerEntriesOffset = GetRequiredFieldOffset(
+        "nt!_KTIMER_TABLE", "TimerEntries");
+    const auto listOffset = GetRequiredFieldOffset(
+        "nt!_KTIMER_TABLE_ENTRY", "Entry");
+    const auto timerListEntryOffset = GetRequiredFieldOffset(
+        "nt!_KTIMER", "TimerListEntry");
+    const auto dpcOffset = GetRequiredFieldOffset("nt!_KTIMER", "Dpc");
+    const auto deferredContextOffset = GetRequiredFieldOffset(
+        "nt!_KDPC", "DeferredContext");
+    ULONG timerTableSize = 0;
+    ULONG entrySize = 0;
+    if (!m_Provider.GetTypeSize("nt!_KTIMER_TABLE", timerTableSize) ||
+        !m_Provider.GetTypeSize("nt!_KTIMER_TABLE_ENTRY", entrySize) ||
+        !entrySize || timerTableSize < timerEntriesOffset)
+    {
+        throw std::runtime_error("nt!_KTIMER_TABLE could not be resolved.");
+    }
+
+    // The number of lists differs by versions, and it is calculated from the
+    // size of the table
+    const auto numberOfEntries = (timerTableSize - timerEntriesOffset)
+        / entrySize;
+    std::vector<std::uint8_t> entries(numberOfEntries * entrySize);
+
+    m_Statistics->UnitName = "processors";
+    m_Statistics->NumberOfUnits = numberOfProcessors;
+    Progress progress(&m_Provider, "Phase 0", "processors",
+        numberOfProcessors);
+    std::vector<std::tuple<ULONG64, ULONG64>> references;
+    for (ULONG processor = 0; processor < numberOfProcessors; ++processor)
+    {
+        if (IsBudgetExhausted())
+        {
+            break;
+        }
+        ++progress;
+        m_Statistics->NumberOfUnitsDone++;
+
+        ULONG64 prcb = 0;
+        if (!m_Provider.ReadPointer(kiProcessorBlock + processor * 8, prcb) ||
+            !prcb)
+        {
+            continue;
+        }
+        const auto timerEntries = prcb + timerTableOffset + timerEntriesOffset;
+        if (!ReadContents(timerEntries, entries.data(),
+            static_cast<ULONG>(entries.size())))
+        {
+            continue;
+        }
+
+        // Walk each list of timers
+        for (SIZE_T i = 0; i < numberOfEntries; ++i)
+        {
+            const auto head = timerEntries + i * entrySize + listOffset;
+            auto next = *reinterpret_cast<ULONG64*>(
+                entries.data() + i * entrySize + listOffset);
+            for (SIZE_T n = 0; n < MAXIMUM_TIMERS_PER_LIST &&
+                next != head && IsKernelAddress(next); ++n)
+            {
+                const auto timer = next - timerListEntryOffset;
+                references.emplace_back(timer, timer);
+                if (!m_Provider.ReadPointer(next, next))
+                {
+                    m_Statistics->NumberOfReadFailures++;
+                    break;
+                }
+
+                // Decode the DPC and take DeferredContext from it
+                ULONG64 dpc = 0;
+                if (!m_Provider.ReadPointer(timer + dpcOffset, dpc))
+                {
+                    m_Statistics->NumberOfReadFailures++;
+                    continue;
+                }
+                if (isEncoded)
+                {
+                    dpc = DecodeTimerDpc(timer, dpc, kiWaitNever,
+                        kiWaitAlways);
+                }
+                if (!IsKernelAddress(dpc))
+                {
+                    continue;
+                }
+                references.emplace_back(timer, dpc);
+                ULONG64 deferredContext = 0;
+                if (m_Provider.ReadPointer(dpc + deferredContextOffset,
+                    deferredContext) && IsKernelAddress(deferredContext))
+                {
+                    references.emplace_back(timer, deferredContext);
+                }
+            }
+        }
+    }
+    return references;
+}
+
+
+// Returns an offset of a field or throws std::runtime_error
+ULONG Scanner::GetRequiredFieldOffset(
+    __in const char* Type,
+    __in const char* Field)
+{
+    ULONG offset = 0;
+    if (!m_Provider.GetFieldOffset(Type, Field, offset))
+    {
+        std::ostringstream ss;
+        ss << Type << "." << Field << " could not be resolved.";
+        throw std::runtime_error(ss.str());
+    }
+    return offset;
+}
+
+
+// Collects PatchGuard pages reside in NonPagedPool
+std::vector<std::tuple<BigPoolEntry, RandomnessInfo>>
+Scanner::FindPgPagesFromNonPagedPool()
+{
+    ULONG64 offset = 0;
+    const auto mmNonPagedPoolStart = GetNonPagedPoolStart();
+
+    // Read PoolBigPageTableSize
+    if (!m_Provider.GetSymbolOffset("nt!PoolBigPageTableSize", offset))
+    {
+        throw std::runtime_error("nt!PoolBigPageTableSize could not be found.");
+    }
+    ULONG64 poolBigPageTableSize = 0;
+    if (!m_Provider.ReadPointer(offset, poolBigPageTableSize))
+    {
+        throw std::runtime_error("nt!PoolBigPageTableSize could not be read.");
+    }
+
+    // Read PoolBigPageTable
+    if (!m_Provider.GetSymbolOffset("nt!PoolBigPageTable", offset))
+    {
+        throw std::runtime_error("nt!PoolBigPageTable could not be found.");
+    }
+    ULONG64 poolBigPageTable = 0;
+    if (!m_Provider.ReadPointer(offset, poolBigPageTable))
+    {
+        throw std::runtime_error("nt!PoolBigPageTable could not be read.");
+    }
+
+    // Select the layout of the table once and run the walker specialized for
+    // it
+    const auto entrySize = GetBigPageEntrySize();
+    switch (entrySize)
+    {
+    case PoolTrackerBigPagesV1::EntrySize:
+        return FindPgPagesFromBigPageTable<PoolTrackerBigPagesV1>(
+            poolBigPageTable, static_cast<SIZE_T>(poolBigPageTableSize),
+            mmNonPagedPoolStart);
+    case PoolTrackerBigPagesV2::EntrySize:
+        return FindPgPagesFromBigPageTable<PoolTrackerBigPagesV2>(
+            poolBigPageTable, static_cast<SIZE_T>(poolBigPageTableSize),
+            mmNonPagedPoolStart);
+    default:
+        std::ostringstream ss;
+        ss << "nt!_POOL_TRACKER_BIG_PAGES has an unsupported size (0x"
+           << std::hex << entrySize << ").";
+        throw std::runtime_error(ss.str());
+    }
+}
+
+
+// Returns MmNonPagedPoolStart if it is possible. On Windows 8.1, this symbol
+// has been removed and the start of the region used on that version is
+// assumed in the detected paging mode instead.
+ULONG64 Scanner::GetNonPagedPoolStart()
+{
+    ULONG64 offset = 0;
+    ULONG64 mmNonPagedPoolStart = m_DefaultNonPagedPoolStart;
+    if (m_Provider.GetSymbolOffset("nt!MmNonPagedPoolStart", offset))
+    {
+        if (!m_Provider.ReadPointer(offset, mmNonPagedPoolStart))
+        {
+            throw std::runtime_error("nt!MmNonPagedPoolStart could not be read.");
+        }
+    }
+    return mmNonPagedPoolStart;
+}
+
+
+// Returns the size of nt!_POOL_TRACKER_BIG_PAGES. When type information is
+// not available, the size used on older kernels is assumed.
+ULONG Scanner::GetBigPageEntrySize()
+{
+    ULONG size = 0;
+    if (!m_Provider.GetTypeSize("nt!_POOL_TRACKER_BIG_PAGES", size))
+    {
+        return PoolTrackerBigPagesV1::EntrySize;
+    }
+    return size;
+}
+
+
+// Walks PoolBigPageTable whose entries are in the given layout
+template <typename Layout>
+std::vector<std::tuple<BigPoolEntry, RandomnessInfo>>
+Scanner::FindPgPagesFromBigPageTable(
+    __in ULONG64 PoolBigPageTable,
+    __in SIZE_T PoolBigPageTableSize,
+    __in ULONG64 MmNonPagedPoolStart)
+{
+    // Read actual PoolBigPageTable contents
+    ULONG readBytes = 0;
+    std::vector<typename Layout::ENTRY> table(PoolBigPageTableSize);
+    if (!m_Provider.ReadVirtual(PoolBigPageTable, table.data(),
+        static_cast<ULONG>(table.size() * sizeof(typename Layout::ENTRY)),
+        &readBytes))
+    {
+        throw std::runtime_error("nt!PoolBigPageTable could not be read.");
+    }
+
+    // Build classification stages
+    typedef CandidatePipeline<Candidate> Pipeline;
+    Pipeline pipeline;
+    pipeline.AddStage("Size", Pipeline::StageKind::CpuOnly,
+        [](Candidate& C)
+    {
+        // Filter by the size of region
+        return (MINIMUM_REGION_SIZE <= C.Size && C.Size <= MAXIMUM_REGION_SIZE);
+    });
+    pipeline.AddStage("Address", Pipeline::StageKind::CpuOnly,
+        [MmNonPagedPoolStart](Candidate& C)
+    {
+        // Filter by the address. It is reasonable to expect that the pool type
+        // is NonPagedPool but it is not always true.
+        return (C.Va >= MmNonPagedPoolStart);
+    });
+    pipeline.AddStage("Attribute", Pipeline::StageKind::RequiresRead,
+        [this](Candidate& C)
+    {
+        // Filter by the page protection
+        return IsPatchGuardPageAttribute(C.Va);
+    });
+    const auto readStage = pipeline.AddStage("Read",
+        Pipeline::StageKind::RequiresRead,
+        [this](Candidate& C)
+    {
+        return ReadContents(C.Va, C.Contents.data() + sizeof(ULONG64),
+            EXAMINATION_BYTES);
+    });
+    AddContentStages(pipeline, readStage);
+
+    // Split the table into chunks and rank them by the number of entries that
+    // pass the cheap filters so that the most promising parts of the table are
+    // analyzed first when time is limited
+    std::vector<std::tuple<SIZE_T, SIZE_T>> chunks;  // (score, start index)
+    for (SIZE_T start = 0; start < PoolBigPageTableSize;
+        start += BIG_POOL_CHUNK_SIZE)
+    {
+        SIZE_T score = 0;
+        for (auto i = start;
+            i < start + BIG_POOL_CHUNK_SIZE && i < PoolBigPageTableSize; ++i)
+        {
+            const auto startAddr = Layout::GetVa(table[i]);
+            const auto size = Layout::GetSize(table[i]);
+            if (startAddr && !(startAddr & 1) &&
+                MINIMUM_REGION_SIZE <= size && size <= MAXIMUM_REGION_SIZE &&
+                startAddr >= MmNonPagedPoolStart)
+            {
+                score++;
+            }
+        }
+        chunks.emplace_back(score, start);
+    }
+    std::stable_sort(chunks.begin(), chunks.end(), [](
+        const std::tuple<SIZE_T, SIZE_T>& Lhs,
+        const std::tuple<SIZE_T, SIZE_T>& Rhs)
+    {
+        return std::get<0>(Lhs) > std::get<0>(Rhs);
+    });
+
+    m_Statistics->UnitName = "big pool entries";
+    m_Statistics->NumberOfUnits = PoolBigPageTableSize;
+    Progress progress(&m_Provider, "Phase 1", "entries",
+        PoolBigPageTableSize);
+
+    // When sampling, only chunks having entries that pass the cheap filters
+    // are sampled. The others are known to have no PatchGuard pages. Only
+    // entries in the selected chunks are walked.
+    std::vector<bool> selected(chunks.size(), true);
+    std::unique_ptr<StratifiedSampler> sampler;
+    if (IsSampling())
+    {
+        sampler.reset(new StratifiedSampler(m_SampleFraction, m_Seed));
+        const auto numberOfPromisingChunks = static_cast<SIZE_T>(
+            std::count_if(chunks.begin(), chunks.end(), [](
+                const std::tuple<SIZE_T, SIZE_T>& Chunk)
+        {
+            return std::get<0>(Chunk) != 0;
+        }));
+        selected = sampler->Select(0, numberOfPromisingChunks);
+        selected.resize(chunks.size(), false);
+
+        std::uint64_t numberOfSampledEntries = 0;
+        for (SIZE_T chunkIndex = 0; chunkIndex < chunks.size(); ++chunkIndex)
+        {
+            if (!selected[chunkIndex])
+            {
+                continue;
+            }
+            auto numberOfEntries = PoolBigPageTableSize
+                - std::get<1>(chunks[chunkIndex]);
+            if (numberOfEntries > BIG_POOL_CHUNK_SIZE)
+            {
+                numberOfEntries = BIG_POOL_CHUNK_SIZE;
+            }
+            numberOfSampledEntries += numberOfEntries;
+        }
+        m_Statistics->NumberOfUnits = numberOfSampledEntries;
+        progress.SetTotal(numberOfSampledEntries);
+    }
+
+    // Walk BigPageTable
+    std::vector<std::tuple<BigPoolEntry, RandomnessInfo>> found;
+    for (SIZE_T chunkIndex = 0; chunkIndex < chunks.size(); ++chunkIndex)
+    {
+        if (!selected[chunkIndex])
+        {
+            continue;
+        }
+        const auto numberOfFoundBefore = found.size();
+        const auto start = std::get<1>(chunks[chunkIndex]);
+        for (auto i = start;
+            i < start + BIG_POOL_CHUNK_SIZE && i < PoolBigPageTableSize; ++i)
+        {
+            if (IsBudgetExhausted())
+            {
+                break;
+            }
+            ++progress;
+            m_Statistics->NumberOfUnitsDone++;
+
+            const auto& entry = table[i];
+            const auto startAddr = Layout::GetVa(entry);
+            const auto size = Layout::GetSize(entry);
+
+            // Ignore unused entries
+            if (!startAddr || (startAddr & 1))
+            {
+                continue;
+            }
+
+            // Classify it
+            Candidate candidate;
+            candidate.Va = startAddr;
+            candidate.Size = size;
+            candidate.Key = Layout::GetKey(entry);
+            candidate.IsRead = false;
+            if (!pipeline.Run(candidate))
+            {
+                continue;
+            }
+
+            // It seems to be a PatchGuard page
+            const BigPoolEntry hit = {
+                candidate.Va, candidate.Key, candidate.Size, };
+            found.emplace_back(hit, candidate.Randomness);
+        }
+
+        // A chunk stopped in the middle is not a valid sample
+        if (sampler && !m_Statistics->IsBudgetExhausted)
+        {
+            sampler->Observe(0,
+                static_cast<double>(found.size() - numberOfFoundBefore));
+        }
+    }
+    if (sampler)
+    {
+        m_Statistics->IsSampled = true;
+        m_Statistics->Estimate = sampler->Estimate();
+    }
+    pipeline.DisplayStatistics(m_Provider);
+    return found;
+}
+
+
+// Collects PatchGuard pages reside in independent pages with the walker
+// specialized for the paging mode of the target
+std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>>
+Scanner::FindPgPagesFromIndependentPages(
+    __out std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>>&
+        FoundInLargePages)
+{
+    if (m_NumberOfLevels == FiveLevelPaging::NumberOfLevels)
+    {
+        return FindPgPagesFromPageTables(
+            PagingLayout<FiveLevelPaging>(m_SelfMapIndex), FoundInLargePages);
+    }
+    return FindPgPagesFromPageTables(
+        PagingLayout<FourLevelPaging>(m_SelfMapIndex), FoundInLargePages);
+}
+
+
+// Walks page tables in the given layout
+template <typename Mode>
+std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>>
+Scanner::FindPgPagesFromPageTables(
+    __in const PagingLayout<Mode>& Layout,
+    __out std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>>&
+        FoundInLargePages)
+{
+    ULONG64 offset = 0;
+
+    // MmSystemRangeStart
+    // Without symbols, the start of the upper half of the address space is
+    // used
+    auto mmSystemRangeStart = PagingLayout<Mode>::GetAddress(
+        Mode::NumberOfLevels - 1, 256);
+    if (m_Provider.GetSymbolOffset("nt!MmSystemRangeStart", offset))
+    {
+        if (!m_Provider.ReadPointer(offset, mmSystemRangeStart))
+        {
+            throw std::runtime_error(
+                "nt!MmSystemRangeStart could not be read.");
+        }
+    }
+
+    // Returns the index of the first entry in the table at Level that maps
+    // the system range
+    const auto getFirstSystemIndex = [mmSystemRangeStart](
+        ULONG Level,
+        ULONG64 Table) -> SIZE_T
+    {
+        const auto first = PagingLayout<Mode>::GetIndex(Level,
+            mmSystemRangeStart);
+        return (first > Table * 512)
+            ? static_cast<SIZE_T>(first - Table * 512) : 0;
+    };
+
+    std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>> found;
+
+    // Page tables of each level being analyzed
+    PageTableSnapshot::PageTable pxes, ppes, pdes, ptes;
+
+    // Walk entire page table ((PML5 ->) PXE -> PPE -> PDE -> PTE) from the
+    // beginning of kernel address. Tables of PXE (PML4) are collected first.
+    // With 4-level paging, it is only the top-level table. Entries and tables
+    // are numbered from the bottom of the address space.
+    std::vector<ULONG64> pxeTables(1, 0);
+    for (ULONG level = Mode::NumberOfLevels - 1; level > PxeLevel; --level)
+    {
+        std::vector<ULONG64> childTables;
+        for (const auto table : pxeTables)
+        {
+            GetPtes(Layout.GetTable(level, table), pxes);
+            const auto validEntries = GetPteMatchBitmap(pxes,
+                PTE_VALID | PTE_LARGE_PAGE, PTE_VALID);
+            for (auto index = getFirstSystemIndex(level, table);
+                FindNextSetBit(validEntries, index); ++index)
+            {
+                childTables.push_back(table * 512 + index);
+            }
+        }
+        pxeTables.swap(childTables);
+    }
+
+    // Read all PPEs first to collect page directories to analyze. The budget
+    // is checked before each batch of tables is prefetched, and directories
+    // collected until then are analyzed, which is none when it ran out here.
+    // Page directories are prefetched together only when all of them are
+    // analyzed.
+    const auto nonPagedPoolPxe = Layout.GetEntry(PxeLevel,
+        GetNonPagedPoolStart());
+    std::vector<DirectoryUnit> directories;
+    for (const auto pxeTable : pxeTables)
+    {
+        if (IsBudgetExhausted())
+        {
+            break;
+        }
+        const auto firstPxeIndex = getFirstSystemIndex(PxeLevel, pxeTable);
+        GetPtes(Layout.GetTable(PxeLevel, pxeTable), pxes);
+        PrunePxesBySystemVaType(pxes, Mode::NumberOfLevels);
+        PrefetchChildTables(pxes, firstPxeIndex,
+            Layout.GetTable(PpeLevel, pxeTable * 512));
+
+        const auto validPxes = GetPteMatchBitmap(pxes, PTE_VALID, PTE_VALID);
+        for (auto pxeIndex2 = firstPxeIndex;
+            FindNextSetBit(validPxes, pxeIndex2); ++pxeIndex2)
+        {
+            if (IsBudgetExhausted())
+            {
+                break;
+            }
+
+            // If the PXE is valid, collect PPEs belonging to this
+            const auto pxeIndex1 = pxeTable * 512 + pxeIndex2;
+            const auto currentPxe = Layout.GetTable(PxeLevel, pxeTable)
+                + pxeIndex2 * sizeof(HARDWARE_PTE);
+            GetPtes(Layout.GetTable(PpeLevel, pxeIndex1), ppes);
+            if (!IsSampling())
+            {
+                PrefetchChildTables(ppes, 0,
+                    Layout.GetTable(PdeLevel, pxeIndex1 * 512));
+            }
+
+            // Only PPEs that are valid and not mapping a 1GB page
+            const auto validPpes = GetPteMatchBitmap(ppes,
+                PTE_VALID | PTE_LARGE_PAGE, PTE_VALID);
+            for (SIZE_T ppeIndex2 = 0; FindNextSetBit(validPpes, ppeIndex2);
+                ++ppeIndex2)
+            {
+                DirectoryUnit directory = {
+                    pxeIndex1 * 512 + ppeIndex2, 0, 0, 1, };
+                if (currentPxe == nonPagedPoolPxe)
+                {
+                    directory.Stratum = 0;
+                }
+                directories.push_back(directory);
+            }
+        }
+    }
+
+    // When sampling, directories in the PML4 entry of NonPagedPool and the
+    // others are sampled separately as they are unlike each other. Only the
+    // selected directories are kept so that the others are never read.
+    std::unique_ptr<StratifiedSampler> sampler;
+    if (IsSampling())
+    {
+        sampler.reset(new StratifiedSampler(m_SampleFraction, m_Seed + 1));
+        std::array<std::vector<SIZE_T>, 2> strata;
+        for (SIZE_T i = 0; i < directories.size(); ++i)
+        {
+            strata[directories[i].Stratum].push_back(i);
+        }
+        std::vector<bool> selectedDirectories(directories.size());
+        for (SIZE_T stratum = 0; stratum < strata.size(); ++stratum)
+        {
+            const auto& indexes = strata[stratum];
+            const auto mask = sampler->Select(stratum, indexes.size());
+            for (SIZE_T i = 0; i < indexes.size(); ++i)
+            {
+                selectedDirectories[indexes[i]] = mask[i];
+            }
+        }
+        std::vector<DirectoryUnit> sampledDirectories;
+        for (SIZE_T i = 0; i < directories.size(); ++i)
+        {
+            if (selectedDirectories[i])
+            {
+                sampledDirectories.push_back(directories[i]);
+            }
+        }
+        directories.swap(sampledDirectories);
+    }
+
+    // Read PDEs of the directories to count page tables in each of them for
+    // its priority. Page directories in the same PML4 entry as NonPagedPool
+    // come first, and denser ones are analyzed earlier since they map more
+    // pages.
+    std::uint64_t numberOfPageTables = 0;
+    for (auto& directory : directories)
+    {
+        if (IsBudgetExhausted())
+        {
+            break;
+        }
+        GetPtes(Layout.GetTable(PdeLevel, directory.PpeIndex), pdes);
+        directory.NumberOfPageTables = CountSetBits(GetPteMatchBitmap(
+            pdes, PTE_VALID | PTE_LARGE_PAGE, PTE_VALID));
+        directory.Priority = directory.NumberOfPageTables;
+        if (directory.Stratum == 0)
+        {
+            directory.Priority += 512;
+        }
+        numberOfPageTables += directory.NumberOfPageTables;
+    }
+    std::stable_sort(directories.begin(), directories.end(), [](
+        const DirectoryUnit& Lhs,
+        const DirectoryUnit& Rhs)
+    {
+        return Lhs.Priority > Rhs.Priority;
+    });
+
+    // Build classification stages
+    typedef CandidatePipeline<Candidate> Pipeline;
+    Pipeline pipeline;
+    const auto readStage = pipeline.AddStage("Read",
+        Pipeline::StageKind::RequiresRead,
+        [this](Candidate& C)
+    {
+        // Read the contents of the address that is managed by the PTE unless
+        // they have been copied from the entire page searched for patterns
+        if (!C.IsRead)
+        {
+            C.IsRead = ReadContents(C.Va, C.Contents.data(),
+                static_cast<ULONG>(C.Contents.size()));
+        }
+        return C.IsRead;
+    });
+    AddContentStages(pipeline, readStage);
+    const auto checkSizeHeader = [](Candidate& C)
+    {
+        // Also, check the size of the region. The first page of allocated
+        // pages as independent pages has its own page size in bytes at the
+        // first 8 bytes
+        C.Size = *reinterpret_cast<ULONG64*>(C.Contents.data());
+        return (MINIMUM_REGION_SIZE <= C.Size && C.Size <= MAXIMUM_REGION_SIZE);
+    };
+    pipeline.AddStage("SizeHeader", Pipeline::StageKind::CpuOnly,
+        checkSizeHeader, readStage);
+
+    // 4KB pages inside a RWX large page are classified in the same way, but
+    // the entire large page is read at once first and contents are copied
+    // from it
+    std::vector<std::uint8_t> largePage(LARGE_PAGE_SIZE);
+    ULONG64 largePageBase = 0;
+    Pipeline largePagePipeline;
+    const auto copyStage = largePagePipeline.AddStage("Copy",
+        Pipeline::StageKind::CpuOnly,
+        [&largePage, &largePageBase](Candidate& C)
+    {
+        memcpy(C.Contents.data(), largePage.data() + (C.Va - largePageBase),
+            C.Contents.size());
+        return true;
+    });
+    AddContentStages(largePagePipeline, copyStage);
+    largePagePipeline.AddStage("SizeHeader", Pipeline::StageKind::CpuOnly,
+        checkSizeHeader, copyStage);
+
+    // The same physical page may be mapped at several virtual addresses. Each
+    // physical page is classified only once, and the verdict is reused for its
+    // aliases, which are still reported by their own virtual addresses.
+    PfnBitmap examinedPages;
+    std::unordered_map<ULONG64, std::tuple<SIZE_T, RandomnessInfo>> foundPages;
+    SIZE_T numberOfAliases = 0;
+
+    // When a page is found, the rest of its region given by the size header
+    // is skipped without being read
+    SIZE_T numberOfCoalescedPages = 0;
+
+    // Contents of a page searched for patterns
+    std::vector<std::uint8_t> page((m_Patterns) ? 0x1000 : 0);
+
+    m_Statistics->UnitName = "page tables";
+    m_Statistics->NumberOfUnits = numberOfPageTables;
+    Progress progress(&m_Provider, "Phase 2", "page tables",
+        numberOfPageTables);
+    for (SIZE_T directoryIndex = 0; directoryIndex < directories.size();
+        ++directoryIndex)
+    {
+        if (IsBudgetExhausted())
+        {
+            break;
+        }
+        const auto numberOfFoundBefore = found.size()
+            + FoundInLargePages.size();
+
+        // The region being skipped. PDEs of a directory are visited in
+        // ascending order, so a region may continue into the next page table,
+        // but not into the next directory as they are visited by priority.
+        ULONG64 regionStart = 0;
+        ULONG64 regionEnd = 0;
+
+        // Analyze PDE belonging to this directory
+        const auto ppeIndex1 = directories[directoryIndex].PpeIndex;
+        GetPtes(Layout.GetTable(PdeLevel, ppeIndex1), pdes);
+        PrefetchChildTables(pdes, 0,
+            Layout.GetTable(PteLevel, ppeIndex1 * 512));
+
+        // Select PDEs referencing page tables and PDEs mapping RWX large
+        // pages. An independent page does not use a large page, but regions
+        // in a large page are examined separately.
+        const auto pageTables = GetPteMatchBitmap(pdes,
+            PTE_VALID | PTE_LARGE_PAGE, PTE_VALID);
+        const auto largePages = GetPteMatchBitmap(pdes,
+            PTE_VALID | PTE_WRITE | PTE_LARGE_PAGE | PTE_NO_EXECUTE,
+            PTE_VALID | PTE_WRITE | PTE_LARGE_PAGE);
+        PteMatchBitmap selectedPdes;
+        for (SIZE_T i = 0; i < selectedPdes.size(); ++i)
+        {
+            selectedPdes[i] = pageTables[i] | largePages[i];
+        }
+        for (SIZE_T pdeIndex2 = 0; FindNextSetBit(selectedPdes, pdeIndex2);
+            ++pdeIndex2)
+        {
+            if (IsBudgetExhausted())
+            {
+                break;
+            }
+            const auto pdeIndex1 = ppeIndex1 * 512 + pdeIndex2;
+            const auto pde = pdes[pdeIndex2];
+
+            // The base address of the region mapped by this PDE
+            const auto pdeBase = PagingLayout<Mode>::GetAddress(PdeLevel,
+                pdeIndex1);
+            if (pde.LargePage)
+            {
+                const auto start = GetTickCount64();
+                largePageBase = pdeBase;
+                m_Statistics->NumberOfLargePages++;
+
+                // Read the large page with a single read. When it stops in
+                // the middle, the rest is read 4KB page by 4KB page. Only
+                // pages read entirely are classified so that bytes of the
+                // previous large page are never examined. Bits below 2MB are
+                // not part of the page frame number of a large page.
+                ULONG readBytes = 0;
+                if (!m_Provider.ReadVirtual(largePageBase, largePage.data(),
+                    static_cast<ULONG>(largePage.size()), &readBytes))
+                {
+                    readBytes = 0;
+                }
+                const auto numberOfReadPages = readBytes >> PTI_SHIFT;
+                const auto basePfn = MiGetPageFrameNumber(pde) & ~0x1ffull;
+                PteMatchBitmap readPages = {};
+                for (ULONG64 i = 0; i < 512; ++i)
+                {
+                    // Aliases of found pages are reported by their own
+                    // virtual addresses, and all aliases are still searched
+                    // for patterns as decrypted contents are found that way
+                    const auto va = largePageBase + (i << PTI_SHIFT);
+                    const auto isAlias = examinedPages.TestAndSet(basePfn + i);
+                    if (isAlias)
+                    {
+                        numberOfAliases++;
+                        const auto alias = foundPages.find(basePfn + i);
+                        if (alias != foundPages.end())
+                        {
+                            FoundInLargePages.emplace_back(va,
+                                std::get<0>(alias->second),
+                                std::get<1>(alias->second));
+                        }
+                        if (!m_Patterns)
+                        {
+                            continue;
+                        }
+                    }
+
+                    // A page that cannot be read is left unexamined so that
+                    // its aliases are still examined
+                    const auto contents = largePage.data() + (i << PTI_SHIFT);
+                    if (i >= numberOfReadPages &&
+                        !ReadContents(va, contents, 0x1000))
+                    {
+                        if (!isAlias)
+                        {
+                            examinedPages.Clear(basePfn + i);
+                        }
+                        continue;
+                    }
+                    if (m_Patterns)
+                    {
+                        SearchPatterns(va, contents, 0x1000);
+                    }
+                    if (!isAlias)
+                    {
+                        readPages[i / 64] |= 1ull << (i % 64);
+                    }
+                }
+                for (SIZE_T i = 0; FindNextSetBit(readPages, i); ++i)
+                {
+                    Candidate candidate;
+                    candidate.Va = largePageBase + (i << PTI_SHIFT);
+                    candidate.Size = 0;
+                    candidate.Key = 0;
+                    candidate.IsRead = false;
+                    if (!largePagePipeline.Run(candidate))
+                    {
+                        continue;
+                    }
+                    foundPages.emplace(basePfn + i, std::make_tuple(
+                        static_cast<SIZE_T>(candidate.Size),
+                        candidate.Randomness));
+                    FoundInLargePages.emplace_back(candidate.Va,
+                        static_cast<SIZE_T>(candidate.Size),
+                        candidate.Randomness);
+                }
+                m_Statistics->LargePageMilliseconds +=
+                    GetTickCount64() - start;
+                continue;
+            }
+            ++progress;
+            m_Statistics->NumberOfUnitsDone++;
+
+            // If the PDE is valid, analyze PTE belonging to this. Only PTEs
+            // that are Valid and Readable/Writable/Executable are visited.
+            GetPtes(Layout.GetTable(PteLevel, pdeIndex1), ptes);
+            const auto candidates = GetPteMatchBitmap(ptes,
+                PTE_VALID | PTE_WRITE | PTE_NO_EXECUTE,
+                PTE_VALID | PTE_WRITE);
+            for (SIZE_T pteIndex2 = 0; FindNextSetBit(candidates, pteIndex2);
+                ++pteIndex2)
+            {
+                // This page might be PatchGuard page, so let's analyze it
+                const auto pte = ptes[pteIndex2];
+                const auto virtualAddress = pdeBase + (pteIndex2 << PTI_SHIFT);
+
+                // Decrypted contents are rejected by the pipeline, so every
+                // page including skipped ones is searched regardless of its
+                // verdict. The page is read only once and also classified.
+                const auto isPageRead = (m_Patterns &&
+                    ReadContents(virtualAddress, page.data(), 0x1000));
+                if (isPageRead)
+                {
+                    SearchPatterns(virtualAddress, page.data(), page.size());
+                }
+                if (regionStart <= virtualAddress && virtualAddress < regionEnd)
+                {
+                    numberOfCoalescedPages++;
+                    continue;
+                }
+
+                // Reuse the verdict if the physical page has been examined
+                // through another virtual address
+                const auto pfn = MiGetPageFrameNumber(pte);
+                if (examinedPages.TestAndSet(pfn))
+                {
+                    numberOfAliases++;
+                    const auto alias = foundPages.find(pfn);
+                    if (alias != foundPages.end())
+                    {
+                        found.emplace_back(virtualAddress,
+                            std::get<0>(alias->second),
+                            std::get<1>(alias->second));
+                    }
+                    continue;
+                }
+
+                // Classify it
+                Candidate candidate;
+                candidate.Va = virtualAddress;
+                candidate.Size = 0;
+                candidate.Key = 0;
+                candidate.IsRead = isPageRead;
+                if (isPageRead)
+                {
+                    memcpy(candidate.Contents.data(), page.data(),
+                        candidate.Contents.size());
+                }
+                const auto isFound = pipeline.Run(candidate);
+
+                // A page that could not be read is left unexamined so that
+                // its aliases are still examined
+                if (!candidate.IsRead)
+                {
+                    examinedPages.Clear(pfn);
+                }
+                if (!isFound)
+                {
+                    continue;
+                }
+                regionStart = candidate.Va + 0x1000;
+                regionEnd = candidate.Va + (candidate.Size & ~0xfffull);
+                foundPages.emplace(pfn, std::make_tuple(
+                    static_cast<SIZE_T>(candidate.Size),
+                    candidate.Randomness));
+
+                // It seems to be a PatchGuard page
+                found.emplace_back(candidate.Va,
+                    static_cast<SIZE_T>(candidate.Size),
+                    candidate.Randomness);
+            }
+        }
+
+        // A directory stopped in the middle is not a valid sample
+        if (sampler && !m_Statistics->IsBudgetExhausted)
+        {
+            sampler->Observe(directories[directoryIndex].Stratum,
+                static_cast<double>(found.size() + FoundInLargePages.size()
+                    - numberOfFoundBefore));
+        }
+    }
+    if (sampler)
+    {
+        m_Statistics->IsSampled = true;
+        m_Statistics->Estimate = sampler->Estimate();
+    }
+    pipeline.DisplayStatistics(m_Provider);
+    if (m_Statistics->NumberOfLargePages)
+    {
+        largePagePipeline.DisplayStatistics(m_Provider);
+    }
+    m_Provider.Out("  %Iu aliased pages reused earlier verdicts\n",
+        numberOfAliases);
+    m_Provider.Out("  %Iu pages skipped as parts of recovered regions\n",
+        numberOfCoalescedPages);
+    if (m_Patterns)
+    {
+        LARGE_INTEGER frequency = {};
+        QueryPerformanceFrequency(&frequency);
+        const auto seconds = static_cast<double>(m_SearchTicks)
+            / frequency.QuadPart;
+        m_Provider.Out("  %I64u KB searched for %Iu patterns at %.1f MB/s\n",
+            m_NumberOfSearchedBytes / 1024, m_Patterns->GetNumberOfPatterns(),
+            (seconds) ? m_NumberOfSearchedBytes / seconds / 1024 / 1024 : 0.0);
+    }
+    return found;
+}
+
+
+// Adds stages checking randomness of contents read by ReadStage
+void Scanner::AddContentStages(
+    __inout CandidatePipeline<Candidate>& Pipeline,
+    __in SIZE_T ReadStage)
+{
+    const auto cpuOnly = CandidatePipeline<Candidate>::StageKind::CpuOnly;
+    Pipeline.AddStage("Distinctive", cpuOnly,
+        [](Candidate& C)
+    {
+        C.Randomness.NumberOfDistinctiveNumbers = GetNumberOfDistinctiveNumbers(
+            C.Contents.data() + sizeof(ULONG64), EXAMINATION_BYTES);
+        return (C.Randomness.NumberOfDistinctiveNumbers
+            <= MAXIMUM_DISTINCTIVE_NUMBER);
+    }, ReadStage);
+    Pipeline.AddStage("Randomness", cpuOnly,
+        [](Candidate& C)
+    {
+        C.Randomness.Ramdomness = GetRamdomness(
+            C.Contents.data() + sizeof(ULONG64), EXAMINATION_BYTES);
+        return (C.Randomness.Ramdomness >= MINIMUM_RANDOMNESS);
+    }, ReadStage);
+}
+
+
+// Reads contents of a candidate. Returns false and counts the failure when
+// any part of it could not be read, so that stale bytes left in the buffer by
+// an earlier read are never examined.
+bool Scanner::ReadContents(
+    __in ULONG64 Va,
+    __out void* Buffer,
+    __in ULONG Size)
+{
+    ULONG readBytes = 0;
+    if (!m_Provider.ReadVirtual(Va, Buffer, Size, &readBytes) ||
+        readBytes != Size)
+    {
+        m_Statistics->NumberOfReadFailures++;
+        return false;
+    }
+    return true;
+}
+
+
+// Returns true when the time budget ran out or the scan has been cancelled.
+// Once it returns true, the current phase is marked as partial.
+bool Scanner::IsBudgetExhausted()
+{
+    const auto isCancelled = m_IsCancelled && m_IsCancelled();
+    if (!isCancelled && (!m_Deadline || GetTickCount64() < m_Deadline))
+    {
+        return false;
+    }
+    m_Statistics->IsBudgetExhausted = true;
+    return true;
+}
+
+
+// Reads the system VA type of each PML4 entry in the system half. Returns
+// false when the table is not available or does not look like one.
+bool Scanner::GetSystemVaTypes(
+    __out std::array<std::uint8_t, 256>& Types)
+{
+    // The table is in nt!_MI_VISIBLE_STATE on Windows 10, which is referenced
+    // by MiVisibleState or embedded in MiState, and is a global variable on
+    // Windows 8.1
+    ULONG64 offset = 0;
+    ULONG64 table = 0;
+    ULONG typeOffset = 0;
+    ULONG visibleStateOffset = 0;
+    if (m_Provider.GetFieldOffset("nt!_MI_VISIBLE_STATE", "SystemVaType",
+        typeOffset))
+    {
+        ULONG64 visibleState = 0;
+        if (m_Provider.GetSymbolOffset("nt!MiVisibleState", offset) &&
+            m_Provider.ReadPointer(offset, visibleState) && visibleState)
+        {
+            table = visibleState + typeOffset;
+        }
+        else if (m_Provider.GetSymbolOffset("nt!MiState", offset) &&
+            m_Provider.GetFieldOffset("nt!_MI_SYSTEM_INFORMATION", "Vs",
+                visibleStateOffset))
+        {
+            table = offset + visibleStateOffset + typeOffset;
+        }
+    }
+    else if (m_Provider.GetSymbolOffset("nt!MiSystemVaType", offset))
+    {
+        table = offset;
+    }
+    ULONG readBytes = 0;
+    if (!table ||
+        !m_Provider.ReadVirtual(table, Types.data(),
+            static_cast<ULONG>(Types.size()), &readBytes) ||
+        readBytes != Types.size())
+    {
+        return false;
+    }
+
+    // Reject a table without NonPagedPool, which is always present. Unknown
+    // types are accepted as they are never pruned.
+    const auto nonPagedPool = static_cast<std::uint8_t>(
+        SystemVaType::NonPagedPool);
+    return std::find(Types.begin(), Types.end(), nonPagedPool) != Types.end();
+}
+
+
+// Invalidates PXEs of system regions that never have PatchGuard pages such
+// as paged pool, the system cache and session space, so that neither they nor
+// their page tables are read. Nothing is pruned without the system VA types
+// or with 5-level paging.
+void Scanner::PrunePxesBySystemVaType(
+    __inout PageTableSnapshot::PageTable& Pxes,
+    __in ULONG NumberOfLevels)
+{
+    // It is not known how the types are recorded with 5-level paging
+    if (NumberOfLevels != FourLevelPaging::NumberOfLevels)
+    {
+        return;
+    }
+
+    std::array<std::uint8_t, NUMBER_OF_SYSTEM_REGIONS> types;
+    if (!GetSystemVaTypes(types))
+    {
+        m_Provider.Out("  System VA types are not available. No region is "
+            "skipped.\n");
+        return;
+    }
+
+    std::array<SIZE_T, 256> numberOfPrunedByType = {};
+    for (SIZE_T i = 0; i < NUMBER_OF_SYSTEM_REGIONS; ++i)
+    {
+        auto& pxe = Pxes[Pxes.size() - NUMBER_OF_SYSTEM_REGIONS + i];
+        if (!pxe.Valid || !IsPrunableSystemVaType(types[i]))
+        {
+            continue;
+        }
+        pxe.Valid = 0;
+        numberOfPrunedByType[types[i]]++;
+        m_Statistics->NumberOfPrunedRegions++;
+    }
+    for (SIZE_T type = 0; type < numberOfPrunedByType.size(); ++type)
+    {
+        if (numberOfPrunedByType[type])
+        {
+            m_Provider.Out("  %Iu %s regions (%Iu GB) skipped by system VA "
+                "type\n", numberOfPrunedByType[type],
+                GetSystemVaTypeName(static_cast<std::uint8_t>(type)),
+                numberOfPrunedByType[type] * 512);
+        }
+    }
+}
+
+
+// Determines the paging mode of the target and the index of its self-map.
+// MmPteBase is used when it exists (Windows 10 1607 and later). Otherwise,
+// the provider may find them, for example, from the top-level table of a
+// guest, and the classic 4-level layout is assumed when nothing is known.
+void Scanner::DetectPagingMode()
+{
+    ULONG64 offset = 0;
+    ULONG64 pteBase = 0;
+    ULONG numberOfLevels = 0;
+    ULONG64 selfMapIndex = 0;
+    if (m_Provider.GetSymbolOffset("nt!MmPteBase", offset) &&
+        m_Provider.ReadPointer(offset, pteBase) && pteBase)
+    {
+        // The mode is the one whose self-map maps PTEs exactly there. Bases
+        // of the two modes never coincide since those of 4-level paging have
+        // some of bits 39-47 set, which are always clear with 5-level paging.
+        const auto fourLevelIndex =
+            PagingLayout<FourLevelPaging>::FindSelfMapIndex(pteBase);
+        const auto fiveLevelIndex =
+            PagingLayout<FiveLevelPaging>::FindSelfMapIndex(pteBase);
+        if (fourLevelIndex)
+        {
+            numberOfLevels = FourLevelPaging::NumberOfLevels;
+            selfMapIndex = fourLevelIndex;
+        }
+        else if (fiveLevelIndex)
+        {
+            numberOfLevels = FiveLevelPaging::NumberOfLevels;
+            selfMapIndex = fiveLevelIndex;
+        }
+        else
+        {
+            m_Provider.Out("nt!MmPteBase (%016I64x) is not a base of PTEs.\n",
+                pteBase);
+        }
+    }
+    if (selfMapIndex ||
+        m_Provider.GetPagingMode(numberOfLevels, selfMapIndex))
+    {
+        m_NumberOfLevels = numberOfLevels;
+        m_SelfMapIndex = selfMapIndex;
+    }
+
+    if (m_NumberOfLevels == FiveLevelPaging::NumberOfLevels)
+    {
+        SetPagingLayout(PagingLayout<FiveLevelPaging>(m_SelfMapIndex));
+    }
+    else
+    {
+        m_NumberOfLevels = FourLevelPaging::NumberOfLevels;
+        SetPagingLayout(PagingLayout<FourLevelPaging>(m_SelfMapIndex));
+    }
+    m_Provider.Out("%lu-level paging, self-map index 0x%I64x (PTE base "
+        "%016I64x)\n", m_NumberOfLevels, m_SelfMapIndex, m_PteBase);
+}
+
+
+// Keeps bases of PTEs and PDEs used for addresses not walked from the top
+template <typename Mode>
+void Scanner::SetPagingLayout(
+    __in const PagingLayout<Mode>& Layout)
+{
+    m_PteBase = Layout.GetTable(PteLevel, 0);
+    m_PdeBase = Layout.GetTable(PdeLevel, 0);
+    m_VirtualAddressMask = (1ull << Mode::VirtualAddressBits) - 1;
+    m_DefaultNonPagedPoolStart = Layout.GetDefaultNonPagedPoolStart();
+}
+
+
+// Returns true when the address is a canonical address in the kernel half of
+// the detected paging mode, in which all bits above the most significant bit
+// of the virtual address are set
+bool Scanner::IsKernelAddress(
+    __in ULONG64 Address) const
+{
+    return Address >= ~(m_VirtualAddressMask >> 1);
+}
+
+
+// Sampling is requested by a fraction below one
+bool Scanner::IsSampling() const
+{
+    return m_SampleFraction > 0.0 && m_SampleFraction < 1.0;
+}
+
+
+// Searches contents of RWX memory for patterns when they are given
+void Scanner::SearchPatterns(
+    __in ULONG64 Va,
+    __in const std::uint8_t* Contents,
+    __in SIZE_T Size)
+{
+    if (!m_Patterns)
+    {
+        return;
+    }
+    LARGE_INTEGER start = {}, end = {};
+    QueryPerformanceCounter(&start);
+    m_Matches.clear();
+    m_Patterns->Search(Contents, Size, m_Matches);
+    QueryPerformanceCounter(&end);
+    m_SearchTicks += end.QuadPart - start.QuadPart;
+    m_NumberOfSearchedBytes += Size;
+    for (const auto& match : m_Matches)
+    {
+        m_Decrypted.emplace_back(Va + match.Offset, match.PatternIndex);
+    }
+}
+
+
+// Fills Ptes with PTEs in one page
+void Scanner::GetPtes(
+    __in ULONG64 PteBase,
+    __out PageTableSnapshot::PageTable& Ptes)
+{
+    if (!m_PageTables.GetTable(m_Provider, PteBase, Ptes))
+    {
+        throw std::runtime_error("The given address could not be read.");
+    }
+}
+
+
+// Reads page tables referenced by valid entries in Ptes in batches. Entries
+// mapping large pages do not reference page tables. ChildTableBase is the
+// address of the page table referenced by the first entry in Ptes.
+void Scanner::PrefetchChildTables(
+    __in const std::array<HARDWARE_PTE, 512>& Ptes,
+    __in SIZE_T StartIndex,
+    __in ULONG64 ChildTableBase)
+{
+    auto runStart = StartIndex;
+    for (auto i = StartIndex; i <= Ptes.size(); ++i)
+    {
+        if (i < Ptes.size() && Ptes[i].Valid && !Ptes[i].LargePage)
+        {
+            continue;
+        }
+        if (i > runStart)
+        {
+            m_PageTables.Prefetch(m_Provider, ChildTableBase + 0x1000 * runStart,
+                i - runStart);
+        }
+        runStart = i + 1;
+    }
+}
+
+
+// Returns true when page protection of the given page or a parant page
+// of the given page is Valid and Readable/Writable/Executable.
+bool Scanner::IsPatchGuardPageAttribute(
+    __in ULONG64 PageBase)
+{
+    const auto va = PageBase & m_VirtualAddressMask;
+    const auto pteAddr = m_PteBase + (va >> PTI_SHIFT) * sizeof(HARDWARE_PTE);
+    if (IsPageValidReadWriteExecutable(pteAddr))
+    {
+        return true;
+    }
+    const auto pdeAddr = m_PdeBase + (va >> PDI_SHIFT) * sizeof(HARDWARE_PTE);
+    if (IsPageValidReadWriteExecutable(pdeAddr))
+    {
+        return true;
+    }
+    return false;
+}
+
+
+// Returns true when page protection of the given page is
+// Readable/Writable/Executable.
+bool Scanner::IsPageValidReadWriteExecutable(
+    __in ULONG64 PteAddr)
+{
+    HARDWARE_PTE pte = {};
+    if (!m_PageTables.GetEntry(m_Provider, PteAddr, pte))
+    {
+        return false;
+    }
+    return pte.Valid
+        && pte.Write
+        && !pte.NoExecute;
+}
+
+
+namespace {
+
+
+// Returns the number of 0x00 and 0xff in the given range
+ULONG GetNumberOfDistinctiveNumbers(
+    __in void* Addr,
+    __in SIZE_T Size)
+{
+    const auto p = static_cast<UCHAR*>(Addr);
+    ULONG count = 0;
+    for (SIZE_T i = 0; i < Size; ++i)
+    {
+        if (p[i] == 0xff || p[i] == 0x00)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+
+// Returns the number of unique bytes in the given range.
+// For example, it returns 3 for the following bytes
+// 00 01 01 02 02 00 02
+ULONG GetRamdomness(
+    __in void* Addr,
+    __in SIZE_T Size)
+{
+    const auto p = static_cast<UCHAR*>(Addr);
+    std::uint64_t seen[256 / 64] = {};
+    for (SIZE_T i = 0; i < Size; ++i)
+    {
+        seen[p[i] / 64] |= 1ULL << (p[i] % 64);
+    }
+    ULONG count = 0;
+    for (auto bits : seen)
+    {
+        count += CountSetBits(bits);
+    }
+    return count;
+}
+
+
+
+// Decodes a pointer to KDPC stored in KTIMER in the same way as the kernel
+ULONG64 DecodeTimerDpc(
+    __in ULONG64 Timer,
+    __in ULONG64 EncodedDpc,
+    __in ULONG64 WaitNever,
+    __in ULONG64 WaitAlways)
+{
+    auto dpc = EncodedDpc ^ WaitNever;
+    dpc = _rotl64(dpc, static_cast<UCHAR>(WaitNever));
+    dpc ^= Timer;
+    dpc = _byteswap_uint64(dpc);
+    dpc ^= WaitAlways;
+    return dpc;
+}
+
+
+// Returns true when regions of the type never have NonPagedPool or
+// independent pages. Unknown types are walked.
+bool IsPrunableSystemVaType(
+    __in std::uint8_t Type)
+{
+    switch (static_cast<SystemVaType>(Type))
+    {
+    case SystemVaType::SessionSpace:
+    case SystemVaType::ProcessSpace:
+    case SystemVaType::PfnDatabase:
+    case SystemVaType::PagedPool:
+    case SystemVaType::SpecialPoolPaged:
+    case SystemVaType::SystemCache:
+    case SystemVaType::SessionGlobalSpace:
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+const char* GetSystemVaTypeName(
+    __in std::uint8_t Type)
+{
+    static const char* const NAMES[] = {
+        "Unused", "SessionSpace", "ProcessSpace", "BootLoaded", "PfnDatabase",
+        "NonPagedPool", "PagedPool", "SpecialPoolPaged", "SystemCache",
+        "SystemPtes", "Hal", "SessionGlobalSpace", "DriverImages",
+        "SystemPtesLarge", "KernelStacks", "SecureNonPagedPool",
+        "KernelShadowStacks",
+    };
+    return (Type < _countof(NAMES)) ? NAMES[Type] : "Unknown";
+}
+
+
+} // End of namespace {unnamed}
@@ -0,0 +1,313 @@
+//
+// This module declears a class responsible for finding PatchGuard pages
+// through a ScanProvider. It does not depend on the debugger engine so that
+// it can be driven by the debugger extension as well as by the C API.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <array>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "pte.h"
+#include "PagingMode.h"
+#include "ScanProvider.h"
+#include "PageTableSnapshot.h"
+#include "PoolTrackerBigPages.h"
+#include "CandidatePipeline.h"
+#include "PatternMatcher.h"
+#include "StratifiedSampler.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+struct RandomnessInfo
+{
+    ULONG NumberOfDistinctiveNumbers;
+    ULONG Ramdomness;
+};
+
+
+// Statistics of a single analysis phase used for the summary
+struct PhaseStatistics
+{
+    const char* Name;
+    bool IsSkipped;     // The phase did not run
+    ULONG64 ElapsedMilliseconds;
+    SIZE_T NumberOfFound;
+    SIZE_T NumberOfReadFailures;
+    std::string Error;  // Empty when the phase succeeded
+
+    // Coverage of the phase, which may be partial under a time budget
+    const char* UnitName;
+    std::uint64_t NumberOfUnits;
+    std::uint64_t NumberOfUnitsDone;
+    bool IsBudgetExhausted;
+
+    // Cost of examining RWX large pages
+    SIZE_T NumberOfLargePages;
+    ULONG64 LargePageMilliseconds;
+
+    // The estimated number of regions when only samples were analyzed
+    bool IsSampled;
+    SampleEstimate Estimate;
+
+    // PML4 entries not walked as their system VA types never have PatchGuard
+    // pages
+    SIZE_T NumberOfPrunedRegions;
+};
+
+
+struct ScanOptions
+{
+    // Tick count when analysis should stop, or zero when it is unlimited
+    ULONG64 Deadline;
+
+    // Returns true when analysis should stop. Optional.
+    std::function<bool()> IsCancelled;
+
+    // Only pages referenced by timers are analyzed
+    bool TimersOnly;
+
+    // Patterns searched in RWX pages in Phase 2. Optional.
+    const PatternMatcher* Patterns;
+
+    // The fraction of big pool chunks and page directories analyzed, or zero
+    // to analyze all of them, and the seed selecting them
+    double SampleFraction;
+    std::uint64_t Seed;
+};
+
+
+struct ScanResult
+{
+    std::vector<std::tuple<BigPoolEntry, RandomnessInfo>> BigPagePool;
+    std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>> Independent;
+    std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>> LargePage;
+    std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo, ULONG64>> Timer;
+    std::vector<std::tuple<ULONG64, SIZE_T>> Decrypted;    // Pattern index
+    std::vector<PhaseStatistics> Statistics;    // One for each phase
+};
+
+
+class Scanner
+{
+public:
+    // PageTables may be shared by multiple scans of the same target
+    Scanner(
+        __in ScanProvider& Provider,
+        __in PageTableSnapshot& PageTables,
+        __in const ScanOptions& Options);
+
+    ScanResult Scan();
+
+private:
+    template <typename PhaseFunction>
+    auto RunPhase(
+        __inout PhaseStatistics& Statistics,
+        __in PhaseFunction Phase) -> decltype(Phase());
+
+    std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo, ULONG64>>
+        FindPgPagesFromTimers();
+
+    std::vector<std::tuple<ULONG64, ULONG64>> GetTimerReferences();
+
+    ULONG GetRequiredFieldOffset(
+        __in const char* Type,
+        __in const char* Field);
+
+    std::vector<std::tuple<BigPoolEntry, RandomnessInfo>>
+        FindPgPagesFromNonPagedPool();
+
+    template <typename Layout>
+    std::vector<std::tuple<BigPoolEntry, RandomnessInfo>>
+        FindPgPagesFromBigPageTable(
+            __in ULONG64 PoolBigPageTable,
+            __in SIZE_T PoolBigPageTableSize,
+            __in ULONG64 MmNonPagedPoolStart);
+
+    ULONG GetBigPageEntrySize();
+
+    ULONG64 GetNonPagedPoolStart();
+
+    std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>>
+        FindPgPagesFromIndependentPages(
+            __out std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>>&
+                FoundInLargePages);
+
+    template <typename Mode>
+    std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>>
+        FindPgPagesFromPageTables(
+            __in const PagingLayout<Mode>& Layout,
+            __out std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>>&
+                FoundInLargePages);
+
+    void DetectPagingMode();
+
+    template <typename Mode>
+    void SetPagingLayout(
+        __in const PagingLayout<Mode>& Layout);
+
+    bool GetSystemVaTypes(
+        __out std::array<std::uint8_t, 256>& Types);
+
+    void PrunePxesBySystemVaType(
+        __inout PageTableSnapshot::PageTable& Pxes,
+        __in ULONG NumberOfLevels);
+
+    void GetPtes(
+        __in ULONG64 PteBase,
+        __out PageTableSnapshot::PageTable& Ptes);
+
+    void PrefetchChildTables(
+        __in const std::array<HARDWARE_PTE, 512>& Ptes,
+        __in SIZE_T StartIndex,
+        __in ULONG64 ChildTableBase);
+
+    bool IsPatchGuardPageAttribute(
+        __in ULONG64 PageBase);
+
+    bool IsPageValidReadWriteExecutable(
+        __in ULONG64 PteAddr);
+
+    bool IsBudgetExhausted();
+
+    bool IsSampling() const;
+
+    bool IsKernelAddress(
+        __in ULONG64 Address) const;
+
+    void SearchPatterns(
+        __in ULONG64 Va,
+        __in const std::uint8_t* Contents,
+        __in SIZE_T Size);
+
+    ScanProvider& m_Provider;
+    PageTableSnapshot& m_PageTables;
+
+    // Statistics of the current phase
+    PhaseStatistics* m_Statistics;
+
+    // Tick count when analysis should stop, or zero when it is unlimited
+    ULONG64 m_Deadline;
+
+    std::function<bool()> m_IsCancelled;
+
+    bool m_TimersOnly;
+
+    const PatternMatcher* m_Patterns;
+
+    double m_SampleFraction;
+    std::uint64_t m_Seed;
+
+    // Paging mode of the target and the index of its self-map in the
+    // top-level table. Bases of PTEs and PDEs are derived from them.
+    ULONG m_NumberOfLevels;
+    ULONG64 m_SelfMapIndex;
+    ULONG64 m_PteBase;
+    ULONG64 m_PdeBase;
+    ULONG64 m_VirtualAddressMask;
+    ULONG64 m_DefaultNonPagedPoolStart;
+
+    // Matches of patterns and the cost of searching them
+    std::vector<std::tuple<ULONG64, SIZE_T>> m_Decrypted;
+    std::vector<PatternMatcher::Match> m_Matches;   // Reused for each search
+    std::uint64_t m_NumberOfSearchedBytes;
+    std::uint64_t m_SearchTicks;
+
+    // The number of bytes to examine to calculate the number of distinctive
+    // bytes and randomness
+    static const auto EXAMINATION_BYTES = 100;
+
+    // It is not a PatchGuard page if the number of distinctive bytes are bigger
+    // than this number
+    static const auto MAXIMUM_DISTINCTIVE_NUMBER = 5;
+
+    // It is not a PatchGuard page if randomness is smaller than this number
+    static const auto MINIMUM_RANDOMNESS = 50;
+
+    // It is not a PatchGuard page if the size of the page is smaller than this
+    static const auto MINIMUM_REGION_SIZE = 0x004000;
+
+    // It is not a PatchGuard page if the size of the page is larger than this
+    static const auto MAXIMUM_REGION_SIZE = 0xf00000;
+
+    // The number of big pool entries analyzed as a unit of work
+    static const SIZE_T BIG_POOL_CHUNK_SIZE = 0x1000;
+
+    // The size of a page mapped by a PDE
+    static const ULONG LARGE_PAGE_SIZE = 0x200000;
+
+    // The maximum number of processors whose timers are analyzed
+    static const ULONG MAXIMUM_PROCESSORS = 2048;
+
+    // The maximum number of timers followed in a single timer list so that a
+    // list broken by a running target does not loop forever
+    static const SIZE_T MAXIMUM_TIMERS_PER_LIST = 0x1000;
+
+    // A region examined by classification stages
+    struct Candidate
+    {
+        ULONG64 Va;
+        ULONG64 Size;   // From the big pool table or the size header
+        ULONG Key;      // Pool tag when it is a big pool entry
+        RandomnessInfo Randomness;
+        bool IsRead;    // Contents have been read
+
+        // The first 8 bytes are for the size header of independent pages and
+        // examined bytes follow it
+        std::array<std::uint8_t, sizeof(ULONG64) + EXAMINATION_BYTES> Contents;
+    };
+
+    void AddContentStages(
+        __inout CandidatePipeline<Candidate>& Pipeline,
+        __in SIZE_T ReadStage);
+
+    bool ReadContents(
+        __in ULONG64 Va,
+        __out void* Buffer,
+        __in ULONG Size);
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,152 @@
+//
+// This module implements a class responsible for selecting units of work at
+// random and estimating results of all units from the selected ones.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+#include <cmath>
+
+// Other external headers
+// Windows headers
+// Original headers
+#include "StratifiedSampler.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+// The z-score of a two-sided 95% confidence interval
+static const double CONFIDENCE_Z = 1.96;
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+StratifiedSampler::StratifiedSampler(
+    __in double Fraction,
+    __in std::uint64_t Seed)
+    : m_Fraction(Fraction)
+    , m_Random(Seed)
+{
+}
+
+
+// Shuffles indexes of units partially and selects the first ones
+std::vector<bool> StratifiedSampler::Select(
+    __in SIZE_T Stratum,
+    __in SIZE_T NumberOfUnits)
+{
+    GetStratum(Stratum).NumberOfUnits += NumberOfUnits;
+
+    std::vector<bool> selected(NumberOfUnits);
+    if (!NumberOfUnits)
+    {
+        return selected;
+    }
+    auto numberToSelect = static_cast<SIZE_T>(
+        std::ceil(NumberOfUnits * m_Fraction));
+    numberToSelect = (std::max)(numberToSelect, static_cast<SIZE_T>(1));
+    numberToSelect = (std::min)(numberToSelect, NumberOfUnits);
+
+    std::vector<SIZE_T> indexes(NumberOfUnits);
+    for (SIZE_T i = 0; i < indexes.size(); ++i)
+    {
+        indexes[i] = i;
+    }
+    for (SIZE_T i = 0; i < numberToSelect; ++i)
+    {
+        std::uniform_int_distribution<SIZE_T> pick(i, indexes.size() - 1);
+        std::swap(indexes[i], indexes[pick(m_Random)]);
+        selected[indexes[i]] = true;
+    }
+    return selected;
+}
+
+
+void StratifiedSampler::Observe(
+    __in SIZE_T Stratum,
+    __in double Value)
+{
+    auto& stratum = GetStratum(Stratum);
+    stratum.NumberOfObservations++;
+    stratum.Sum += Value;
+    stratum.SumOfSquares += Value * Value;
+}
+
+
+// Sums estimates of strata. The lower bound is never below what has actually
+// been observed.
+SampleEstimate StratifiedSampler::Estimate() const
+{
+    auto total = 0.0;
+    auto variance = 0.0;
+    auto observed = 0.0;
+    for (const auto& stratum : m_Strata)
+    {
+        const auto n = static_cast<double>(stratum.NumberOfObservations);
+        const auto units = static_cast<double>(stratum.NumberOfUnits);
+        if (!n)
+        {
+            continue;
+        }
+        const auto mean = stratum.Sum / n;
+        total += units * mean;
+        observed += stratum.Sum;
+        if (n > 1)
+        {
+            const auto sampleVariance = (std::max)(0.0,
+                (stratum.SumOfSquares - n * mean * mean) / (n - 1));
+            variance += units * units * (1.0 - n / units) * sampleVariance
+                / n;
+        }
+    }
+    const auto margin = CONFIDENCE_Z * std::sqrt((std::max)(0.0, variance));
+    const SampleEstimate estimate = {
+        total,
+        (std::max)(observed, total - margin),
+        total + margin,
+    };
+    return estimate;
+}
+
+
+StratifiedSampler::StratumState& StratifiedSampler::GetStratum(
+    __in SIZE_T Stratum)
+{
+    if (Stratum >= m_Strata.size())
+    {
+        const StratumState empty = {};
+        m_Strata.resize(Stratum + 1, empty);
+    }
+    return m_Strata[Stratum];
+}
+
@@ -0,0 +1,104 @@
+//
+// This module declears a class responsible for selecting units of work at
+// random and estimating results of all units from the selected ones.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// An estimated total and its 95% confidence interval
+struct SampleEstimate
+{
+    double Total;
+    double Lower;
+    double Upper;
+};
+
+
+// Selects the same fraction of units from each stratum at random, and
+// estimates the total of values observed on units as if all units had been
+// analyzed. The variance is that of stratified simple random sampling
+// without replacement, so units more alike should be put in the same
+// stratum. Selection depends only on the seed and the order of calls.
+class StratifiedSampler
+{
+public:
+    StratifiedSampler(
+        __in double Fraction,
+        __in std::uint64_t Seed);
+
+    // Returns whether each of NumberOfUnits units in the stratum is selected.
+    // At least one unit is selected from a stratum that is not empty.
+    std::vector<bool> Select(
+        __in SIZE_T Stratum,
+        __in SIZE_T NumberOfUnits);
+
+    // Records a value of a selected unit that has been analyzed
+    void Observe(
+        __in SIZE_T Stratum,
+        __in double Value);
+
+    SampleEstimate Estimate() const;
+
+private:
+    struct StratumState
+    {
+        SIZE_T NumberOfUnits;
+        SIZE_T NumberOfObservations;
+        double Sum;
+        double SumOfSquares;
+    };
+
+    StratumState& GetStratum(
+        __in SIZE_T Stratum);
+
+    double m_Fraction;
+    std::mt19937_64 m_Random;
+    std::vector<StratumState> m_Strata;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
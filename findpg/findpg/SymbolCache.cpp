@@ -0,0 +1,271 @@
+//
+// This module implements a class responsible for remembering symbols of each
+// kernel build across debugger sessions.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "SymbolCache.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+SymbolCache::SymbolCache(
+    __in ScanProvider& Provider)
+    : m_Provider(Provider)
+    , m_KernelBase(0)
+    , m_NumberOfHits(0)
+    , m_NumberOfMisses(0)
+{
+    ULONG timeDateStamp = 0;
+    ULONG sizeOfImage = 0;
+    if (!m_Provider.GetModuleIdentity("nt", m_KernelBase, timeDateStamp,
+        sizeOfImage))
+    {
+        return;
+    }
+
+    char directory[MAX_PATH] = {};
+    const auto length = GetEnvironmentVariableA("LOCALAPPDATA", directory,
+        _countof(directory));
+    if (!length || length >= _countof(directory))
+    {
+        return;
+    }
+    m_Path = std::string(directory) + "\\findpg";
+    CreateDirectoryA(m_Path.c_str(), nullptr);
+    m_Path += "\\SymbolCache.ini";
+
+    char section[32] = {};
+    sprintf_s(section, "nt_%08X_%08X", timeDateStamp, sizeOfImage);
+    m_Section = section;
+}
+
+
+bool SymbolCache::ReadVirtual(
+    __in ULONG64 Address,
+    __out void* Buffer,
+    __in ULONG Size,
+    __out_opt ULONG* ReadBytes)
+{
+    return m_Provider.ReadVirtual(Address, Buffer, Size, ReadBytes);
+}
+
+
+bool SymbolCache::ReadPointer(
+    __in ULONG64 Address,
+    __out ULONG64& Value)
+{
+    return m_Provider.ReadPointer(Address, Value);
+}
+
+
+bool SymbolCache::GetSymbolOffset(
+    __in const char* Symbol,
+    __out ULONG64& Offset)
+{
+    if (!IsCacheable(Symbol))
+    {
+        return m_Provider.GetSymbolOffset(Symbol, Offset);
+    }
+
+    std::string value;
+    if (m_Unresolved.count(Symbol))
+    {
+        m_NumberOfHits++;
+        return false;
+    }
+    if (Load(Symbol, value))
+    {
+        m_NumberOfHits++;
+        Offset = m_KernelBase + _strtoui64(value.c_str(), nullptr, 16);
+        return true;
+    }
+
+    m_NumberOfMisses++;
+    if (!m_Provider.GetSymbolOffset(Symbol, Offset))
+    {
+        m_Unresolved.insert(Symbol);
+        return false;
+    }
+    std::ostringstream ss;
+    ss << "0x" << std::hex << (Offset - m_KernelBase);
+    Store(Symbol, ss.str());
+    return true;
+}
+
+
+bool SymbolCache::GetTypeSize(
+    __in const char* Type,
+    __out ULONG& Size)
+{
+    if (!IsCacheable(Type))
+    {
+        return m_Provider.GetTypeSize(Type, Size);
+    }
+
+    const auto key = std::string("type:") + Type;
+    std::string value;
+    if (m_Unresolved.count(key))
+    {
+        m_NumberOfHits++;
+        return false;
+    }
+    if (Load(key, value))
+    {
+        m_NumberOfHits++;
+        Size = strtoul(value.c_str(), nullptr, 16);
+        return true;
+    }
+
+    m_NumberOfMisses++;
+    if (!m_Provider.GetTypeSize(Type, Size))
+    {
+        m_Unresolved.insert(key);
+        return false;
+    }
+    std::ostringstream ss;
+    ss << "0x" << std::hex << Size;
+    Store(key, ss.str());
+    return true;
+}
+
+
+bool SymbolCache::GetFieldOffset(
+    __in const char* Type,
+    __in const char* Field,
+    __out ULONG& Offset)
+{
+    if (!IsCacheable(Type))
+    {
+        return m_Provider.GetFieldOffset(Type, Field, Offset);
+    }
+
+    const auto key = std::string("field:") + Type + "." + Field;
+    std::string value;
+    if (m_Unresolved.count(key))
+    {
+        m_NumberOfHits++;
+        return false;
+    }
+    if (Load(key, value))
+    {
+        m_NumberOfHits++;
+        Offset = strtoul(value.c_str(), nullptr, 16);
+        return true;
+    }
+
+    m_NumberOfMisses++;
+    if (!m_Provider.GetFieldOffset(Type, Field, Offset))
+    {
+        m_Unresolved.insert(key);
+        return false;
+    }
+    std::ostringstream ss;
+    ss << "0x" << std::hex << Offset;
+    Store(key, ss.str());
+    return true;
+}
+
+
+// The paging mode depends on the target rather than the build, so it is not
+// cached
+bool SymbolCache::GetPagingMode(
+    __out ULONG& NumberOfLevels,
+    __out ULONG64& SelfMapIndex)
+{
+    return m_Provider.GetPagingMode(NumberOfLevels, SelfMapIndex);
+}
+
+
+bool SymbolCache::GetModuleIdentity(
+    __in const char* Module,
+    __out ULONG64& Base,
+    __out ULONG& TimeDateStamp,
+    __out ULONG& SizeOfImage)
+{
+    return m_Provider.GetModuleIdentity(Module, Base, TimeDateStamp,
+        SizeOfImage);
+}
+
+
+void SymbolCache::Write(
+    __in const char* Text)
+{
+    m_Provider.Write(Text);
+}
+
+
+void SymbolCache::WriteError(
+    __in const char* Text)
+{
+    m_Provider.WriteError(Text);
+}
+
+
+// Returns true when the name belongs to nt and the cache is available
+bool SymbolCache::IsCacheable(
+    __in const char* Name) const
+{
+    return !m_Path.empty() && strncmp(Name, "nt!", 3) == 0;
+}
+
+
+// Returns a value stored in the cache file. Values that are not numbers, such
+// as "none" stored for unresolved symbols by older versions, are ignored.
+bool SymbolCache::Load(
+    __in const std::string& Key,
+    __out std::string& Value) const
+{
+    char value[64] = {};
+    GetPrivateProfileStringA(m_Section.c_str(), Key.c_str(), "", value,
+        _countof(value), m_Path.c_str());
+    Value = value;
+    return Value.compare(0, 2, "0x") == 0;
+}
+
+
+void SymbolCache::Store(
+    __in const std::string& Key,
+    __in const std::string& Value) const
+{
+    WritePrivateProfileStringA(m_Section.c_str(), Key.c_str(), Value.c_str(),
+        m_Path.c_str());
+}
+
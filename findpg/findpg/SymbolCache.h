@@ -0,0 +1,135 @@
+//
+// This module declears a class responsible for remembering symbols of each
+// kernel build across debugger sessions.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <string>
+#include <unordered_set>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "ScanProvider.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Forwards requests to another provider while answering symbol and type
+// queries for nt from a cache file when possible. Offsets are stored as RVAs
+// in a section named after the time stamp and size of the kernel image, so
+// they are reused by any later session with the same build of the kernel
+// without loading its PDB. Symbols that could not be resolved are remembered
+// only during the session, as they may be resolved once symbols are fixed.
+//
+// The cache is an INI file at %LOCALAPPDATA%\findpg\SymbolCache.ini, for
+// example:
+//
+//   [nt_5632D6E6_00880000]
+//   nt!PoolBigPageTable=0x2f5310
+//   type:nt!_POOL_TRACKER_BIG_PAGES=0x18
+class SymbolCache : public ScanProvider
+{
+public:
+    SymbolCache(
+        __in ScanProvider& Provider);
+
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes);
+
+    virtual bool ReadPointer(
+        __in ULONG64 Address,
+        __out ULONG64& Value);
+
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset);
+
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size);
+
+    virtual bool GetFieldOffset(
+        __in const char* Type,
+        __in const char* Field,
+        __out ULONG& Offset);
+
+    virtual bool GetPagingMode(
+        __out ULONG& NumberOfLevels,
+        __out ULONG64& SelfMapIndex);
+
+    virtual bool GetModuleIdentity(
+        __in const char* Module,
+        __out ULONG64& Base,
+        __out ULONG& TimeDateStamp,
+        __out ULONG& SizeOfImage);
+
+    virtual void Write(
+        __in const char* Text);
+
+    virtual void WriteError(
+        __in const char* Text);
+
+    SIZE_T GetNumberOfHits() const { return m_NumberOfHits; }
+    SIZE_T GetNumberOfMisses() const { return m_NumberOfMisses; }
+
+private:
+    bool IsCacheable(
+        __in const char* Name) const;
+
+    bool Load(
+        __in const std::string& Key,
+        __out std::string& Value) const;
+
+    void Store(
+        __in const std::string& Key,
+        __in const std::string& Value) const;
+
+    ScanProvider& m_Provider;
+    std::string m_Path;     // Empty when the cache is not available
+    std::string m_Section;
+    std::unordered_set<std::string> m_Unresolved;   // Never stored
+    ULONG64 m_KernelBase;
+    SIZE_T m_NumberOfHits;
+    SIZE_T m_NumberOfMisses;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
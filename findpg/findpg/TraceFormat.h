@@ -0,0 +1,99 @@
+//
+// This module implements the format of trace files recording accesses of the
+// scanner to a target.
+//
+// A trace file starts with TRACE_FILE_HEADER followed by records. Each record
+// is TRACE_RECORD_HEADER followed by NameLength bytes of a symbol or type name
+// and DataLength bytes of data read. Records are written in the order the
+// scanner issued them.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+// "FPGT"
+static const ULONG TRACE_FILE_SIGNATURE = 0x54475046;
+static const ULONG TRACE_FILE_VERSION = 2;
+
+// The oldest version that can be replayed. Version 1 has no records of
+// GetModuleIdentity and GetNextDifferentlyValidOffset.
+static const ULONG TRACE_FILE_MINIMUM_VERSION = 1;
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+enum class TraceRecordKind : std::uint8_t
+{
+    ReadVirtual = 1,        // Address, Size -> Value (bytes read) and data
+    GetSymbolOffset = 2,    // Name -> Value (offset)
+    GetTypeSize = 3,        // Name -> Value (size)
+    GetFieldOffset = 4,     // Type.Field -> Value (offset)
+    GetPagingMode = 5,      // "PagingMode" -> Size (levels), Value (index)
+    GetModuleIdentity = 6,  // Name -> Address (base), Size (size of image),
+                            //         Value (time stamp)
+    GetNextDifferentlyValidOffset = 7,  // Address -> Value (next address)
+};
+
+
+#include <pshpack1.h>
+struct TRACE_FILE_HEADER
+{
+    ULONG Signature;
+    ULONG Version;
+};
+
+
+struct TRACE_RECORD_HEADER
+{
+    TraceRecordKind Kind;
+    std::uint8_t Succeeded;
+    USHORT NameLength;
+    ULONG Size;
+    ULONG DataLength;
+    ULONG ElapsedMicroseconds;
+    ULONG64 Address;
+    ULONG64 Value;
+};
+#include <poppack.h>
+C_ASSERT(sizeof(TRACE_RECORD_HEADER) == 32);
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
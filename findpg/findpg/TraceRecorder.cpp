@@ -0,0 +1,257 @@
+//
+// This module implements a class responsible for recording accesses of the
+// scanner to a target into a trace file.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+// Original headers
+#include "TraceRecorder.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+ULONG64 GetTicks();
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+TraceRecorder::TraceRecorder(
+    __in ScanProvider& Provider,
+    __in const std::string& Path)
+    : m_Provider(Provider)
+    , m_File(Path, std::ios::binary | std::ios::trunc)
+    , m_NumberOfRecords(0)
+    , m_TicksPerMicrosecond(1.0)
+{
+    if (!m_File)
+    {
+        throw std::runtime_error("The trace file could not be created.");
+    }
+    LARGE_INTEGER frequency = {};
+    if (QueryPerformanceFrequency(&frequency))
+    {
+        m_TicksPerMicrosecond = frequency.QuadPart / 1000000.0;
+    }
+    const TRACE_FILE_HEADER header = {
+        TRACE_FILE_SIGNATURE, TRACE_FILE_VERSION, };
+    m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+
+bool TraceRecorder::ReadVirtual(
+    __in ULONG64 Address,
+    __out void* Buffer,
+    __in ULONG Size,
+    __out_opt ULONG* ReadBytes)
+{
+    const auto start = GetTicks();
+    ULONG readBytes = 0;
+    const auto succeeded = m_Provider.ReadVirtual(Address, Buffer, Size,
+        &readBytes);
+    Record(TraceRecordKind::ReadVirtual, succeeded, nullptr, Address, Size,
+        readBytes, Buffer, (succeeded) ? readBytes : 0, start);
+    if (ReadBytes)
+    {
+        *ReadBytes = readBytes;
+    }
+    return succeeded;
+}
+
+
+// Recorded as a read of 8 bytes so that the replayer does not need to know
+// how the recorded provider reads pointers
+bool TraceRecorder::ReadPointer(
+    __in ULONG64 Address,
+    __out ULONG64& Value)
+{
+    const auto start = GetTicks();
+    const auto succeeded = m_Provider.ReadPointer(Address, Value);
+    Record(TraceRecordKind::ReadVirtual, succeeded, nullptr, Address,
+        sizeof(Value), (succeeded) ? sizeof(Value) : 0, &Value,
+        (succeeded) ? sizeof(Value) : 0, start);
+    return succeeded;
+}
+
+
+bool TraceRecorder::GetSymbolOffset(
+    __in const char* Symbol,
+    __out ULONG64& Offset)
+{
+    const auto start = GetTicks();
+    const auto succeeded = m_Provider.GetSymbolOffset(Symbol, Offset);
+    Record(TraceRecordKind::GetSymbolOffset, succeeded, Symbol, 0, 0,
+        (succeeded) ? Offset : 0, nullptr, 0, start);
+    return succeeded;
+}
+
+
+bool TraceRecorder::GetTypeSize(
+    __in const char* Type,
+    __out ULONG& Size)
+{
+    const auto start = GetTicks();
+    const auto succeeded = m_Provider.GetTypeSize(Type, Size);
+    Record(TraceRecordKind::GetTypeSize, succeeded, Type, 0, 0,
+        (succeeded) ? Size : 0, nullptr, 0, start);
+    return succeeded;
+}
+
+
+bool TraceRecorder::GetFieldOffset(
+    __in const char* Type,
+    __in const char* Field,
+    __out ULONG& Offset)
+{
+    const auto start = GetTicks();
+    const auto succeeded = m_Provider.GetFieldOffset(Type, Field, Offset);
+    const auto name = std::string(Type) + "." + Field;
+    Record(TraceRecordKind::GetFieldOffset, succeeded, name.c_str(), 0, 0,
+        (succeeded) ? Offset : 0, nullptr, 0, start);
+    return succeeded;
+}
+
+
+bool TraceRecorder::GetPagingMode(
+    __out ULONG& NumberOfLevels,
+    __out ULONG64& SelfMapIndex)
+{
+    const auto start = GetTicks();
+    const auto succeeded = m_Provider.GetPagingMode(NumberOfLevels,
+        SelfMapIndex);
+    Record(TraceRecordKind::GetPagingMode, succeeded, "PagingMode", 0,
+        (succeeded) ? NumberOfLevels : 0, (succeeded) ? SelfMapIndex : 0,
+        nullptr, 0, start);
+    return succeeded;
+}
+
+
+bool TraceRecorder::GetModuleIdentity(
+    __in const char* Module,
+    __out ULONG64& Base,
+    __out ULONG& TimeDateStamp,
+    __out ULONG& SizeOfImage)
+{
+    const auto start = GetTicks();
+    const auto succeeded = m_Provider.GetModuleIdentity(Module, Base,
+        TimeDateStamp, SizeOfImage);
+    Record(TraceRecordKind::GetModuleIdentity, succeeded, Module,
+        (succeeded) ? Base : 0, (succeeded) ? SizeOfImage : 0,
+        (succeeded) ? TimeDateStamp : 0, nullptr, 0, start);
+    return succeeded;
+}
+
+
+bool TraceRecorder::GetNextDifferentlyValidOffset(
+    __in ULONG64 Address,
+    __out ULONG64& NextAddress)
+{
+    const auto start = GetTicks();
+    const auto succeeded = m_Provider.GetNextDifferentlyValidOffset(Address,
+        NextAddress);
+    Record(TraceRecordKind::GetNextDifferentlyValidOffset, succeeded,
+        nullptr, Address, 0, (succeeded) ? NextAddress : 0, nullptr, 0,
+        start);
+    return succeeded;
+}
+
+
+void TraceRecorder::Write(
+    __in const char* Text)
+{
+    m_Provider.Write(Text);
+}
+
+
+void TraceRecorder::WriteError(
+    __in const char* Text)
+{
+    m_Provider.WriteError(Text);
+}
+
+
+// Appends a record. StartTicks is the performance counter value when the
+// request was issued.
+void TraceRecorder::Record(
+    __in TraceRecordKind Kind,
+    __in bool Succeeded,
+    __in const char* Name,
+    __in ULONG64 Address,
+    __in ULONG Size,
+    __in ULONG64 Value,
+    __in const void* Data,
+    __in ULONG DataLength,
+    __in ULONG64 StartTicks)
+{
+    const auto elapsed = (GetTicks() - StartTicks) / m_TicksPerMicrosecond;
+    TRACE_RECORD_HEADER header = {};
+    header.Kind = Kind;
+    header.Succeeded = Succeeded;
+    header.NameLength = static_cast<USHORT>((Name) ? strlen(Name) : 0);
+    header.Size = Size;
+    header.DataLength = DataLength;
+    header.ElapsedMicroseconds = static_cast<ULONG>(
+        (elapsed < MAXULONG) ? elapsed : MAXULONG);
+    header.Address = Address;
+    header.Value = Value;
+    m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_File.write(Name, header.NameLength);
+    m_File.write(static_cast<const char*>(Data), DataLength);
+    if (!m_File)
+    {
+        throw std::runtime_error("The trace file could not be written.");
+    }
+    m_NumberOfRecords++;
+}
+
+
+namespace {
+
+
+// Returns the current value of the performance counter
+ULONG64 GetTicks()
+{
+    LARGE_INTEGER counter = {};
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+
+} // End of namespace {unnamed}
+
@@ -0,0 +1,128 @@
+//
+// This module declears a class responsible for recording accesses of the
+// scanner to a target into a trace file.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <fstream>
+#include <string>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "ScanProvider.h"
+#include "TraceFormat.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Forwards all requests to another provider and records them with their
+// results, data and time taken so that the same scan can be replayed later by
+// TraceReplayer without the target.
+class TraceRecorder : public ScanProvider
+{
+public:
+    // Throws std::runtime_error when the file cannot be created
+    TraceRecorder(
+        __in ScanProvider& Provider,
+        __in const std::string& Path);
+
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes);
+
+    virtual bool ReadPointer(
+        __in ULONG64 Address,
+        __out ULONG64& Value);
+
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset);
+
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size);
+
+    virtual bool GetFieldOffset(
+        __in const char* Type,
+        __in const char* Field,
+        __out ULONG& Offset);
+
+    virtual bool GetPagingMode(
+        __out ULONG& NumberOfLevels,
+        __out ULONG64& SelfMapIndex);
+
+    virtual bool GetModuleIdentity(
+        __in const char* Module,
+        __out ULONG64& Base,
+        __out ULONG& TimeDateStamp,
+        __out ULONG& SizeOfImage);
+
+    virtual bool GetNextDifferentlyValidOffset(
+        __in ULONG64 Address,
+        __out ULONG64& NextAddress);
+
+    virtual void Write(
+        __in const char* Text);
+
+    virtual void WriteError(
+        __in const char* Text);
+
+    SIZE_T GetNumberOfRecords() const { return m_NumberOfRecords; }
+
+private:
+    void Record(
+        __in TraceRecordKind Kind,
+        __in bool Succeeded,
+        __in const char* Name,
+        __in ULONG64 Address,
+        __in ULONG Size,
+        __in ULONG64 Value,
+        __in const void* Data,
+        __in ULONG DataLength,
+        __in ULONG64 StartTicks);
+
+    ScanProvider& m_Provider;
+    std::ofstream m_File;
+    SIZE_T m_NumberOfRecords;
+    double m_TicksPerMicrosecond;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,365 @@
+//
+// This module implements a class responsible for replaying a trace file as a
+// target of the scanner.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+#include <fstream>
+
+// Other external headers
+// Windows headers
+// Original headers
+#include "TraceReplayer.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+bool IsValidRecord(
+    __in const TRACE_RECORD_HEADER& Header);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+TraceReplayer::TraceReplayer(
+    __in ScanProvider& Output,
+    __in const std::string& Path,
+    __in bool SimulateLatency)
+    : m_Output(Output)
+    , m_SimulateLatency(SimulateLatency)
+    , m_NumberOfMisses(0)
+    , m_TicksPerMicrosecond(1.0)
+{
+    LARGE_INTEGER frequency = {};
+    if (QueryPerformanceFrequency(&frequency))
+    {
+        m_TicksPerMicrosecond = frequency.QuadPart / 1000000.0;
+    }
+
+    std::ifstream file(Path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("The trace file could not be opened.");
+    }
+    TRACE_FILE_HEADER fileHeader = {};
+    file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
+    if (!file ||
+        fileHeader.Signature != TRACE_FILE_SIGNATURE ||
+        fileHeader.Version < TRACE_FILE_MINIMUM_VERSION ||
+        fileHeader.Version > TRACE_FILE_VERSION)
+    {
+        throw std::runtime_error("The file is not a supported trace file.");
+    }
+
+    for (;;)
+    {
+        Record entry = {};
+        file.read(reinterpret_cast<char*>(&entry.Header), sizeof(entry.Header));
+        if (file.gcount() == 0)
+        {
+            break;
+        }
+
+        // Data is copied to buffers of the scanner as is, so a record whose
+        // data does not fit in the request is never loaded
+        if (!IsValidRecord(entry.Header))
+        {
+            throw std::runtime_error("The trace file has an invalid record.");
+        }
+        std::string name(entry.Header.NameLength, '\0');
+        file.read(&name[0], name.size());
+        entry.DataOffset = m_Data.size();
+        m_Data.resize(m_Data.size() + entry.Header.DataLength);
+        file.read(reinterpret_cast<char*>(m_Data.data() + entry.DataOffset),
+            entry.Header.DataLength);
+        if (!file)
+        {
+            throw std::runtime_error("The trace file is truncated.");
+        }
+
+        const auto index = m_Records.size();
+        m_Records.push_back(entry);
+        switch (entry.Header.Kind)
+        {
+        case TraceRecordKind::ReadVirtual:
+            m_Reads[std::make_tuple(entry.Header.Address, entry.Header.Size)]
+                .Indexes.push_back(index);
+            break;
+        case TraceRecordKind::GetSymbolOffset:
+            m_Symbols[name].Indexes.push_back(index);
+            break;
+        case TraceRecordKind::GetTypeSize:
+            m_Types[name].Indexes.push_back(index);
+            break;
+        case TraceRecordKind::GetFieldOffset:
+            m_Fields[name].Indexes.push_back(index);
+            break;
+        case TraceRecordKind::GetPagingMode:
+            m_PagingModes[name].Indexes.push_back(index);
+            break;
+        case TraceRecordKind::GetModuleIdentity:
+            m_Modules[name].Indexes.push_back(index);
+            break;
+        case TraceRecordKind::GetNextDifferentlyValidOffset:
+            m_NextOffsets[entry.Header.Address].Indexes.push_back(index);
+            break;
+        default:
+            throw std::runtime_error("The trace file has an unknown record.");
+        }
+    }
+}
+
+
+bool TraceReplayer::ReadVirtual(
+    __in ULONG64 Address,
+    __out void* Buffer,
+    __in ULONG Size,
+    __out_opt ULONG* ReadBytes)
+{
+    if (ReadBytes)
+    {
+        *ReadBytes = 0;
+    }
+    const auto it = m_Reads.find(std::make_tuple(Address, Size));
+    if (it == m_Reads.end())
+    {
+        m_NumberOfMisses++;
+        return false;
+    }
+    const auto entry = Find(it->second);
+    Wait(*entry);
+    const auto length = (std::min)(entry->Header.DataLength, Size);
+    memcpy(Buffer, m_Data.data() + entry->DataOffset, length);
+    if (ReadBytes)
+    {
+        *ReadBytes = length;
+    }
+    return entry->Header.Succeeded != 0;
+}
+
+
+bool TraceReplayer::GetSymbolOffset(
+    __in const char* Symbol,
+    __out ULONG64& Offset)
+{
+    const auto it = m_Symbols.find(Symbol);
+    if (it == m_Symbols.end())
+    {
+        m_NumberOfMisses++;
+        return false;
+    }
+    const auto entry = Find(it->second);
+    Wait(*entry);
+    Offset = entry->Header.Value;
+    return entry->Header.Succeeded != 0;
+}
+
+
+bool TraceReplayer::GetTypeSize(
+    __in const char* Type,
+    __out ULONG& Size)
+{
+    const auto it = m_Types.find(Type);
+    if (it == m_Types.end())
+    {
+        m_NumberOfMisses++;
+        return false;
+    }
+    const auto entry = Find(it->second);
+    Wait(*entry);
+    Size = static_cast<ULONG>(entry->Header.Value);
+    return entry->Header.Succeeded != 0;
+}
+
+
+bool TraceReplayer::GetFieldOffset(
+    __in const char* Type,
+    __in const char* Field,
+    __out ULONG& Offset)
+{
+    const auto it = m_Fields.find(std::string(Type) + "." + Field);
+    if (it == m_Fields.end())
+    {
+        m_NumberOfMisses++;
+        return false;
+    }
+    const auto entry = Find(it->second);
+    Wait(*entry);
+    Offset = static_cast<ULONG>(entry->Header.Value);
+    return entry->Header.Succeeded != 0;
+}
+
+
+bool TraceReplayer::GetPagingMode(
+    __out ULONG& NumberOfLevels,
+    __out ULONG64& SelfMapIndex)
+{
+    const auto it = m_PagingModes.find("PagingMode");
+    if (it == m_PagingModes.end())
+    {
+        m_NumberOfMisses++;
+        return false;
+    }
+    const auto entry = Find(it->second);
+    Wait(*entry);
+    NumberOfLevels = entry->Header.Size;
+    SelfMapIndex = entry->Header.Value;
+    return entry->Header.Succeeded != 0;
+}
+
+
+bool TraceReplayer::GetModuleIdentity(
+    __in const char* Module,
+    __out ULONG64& Base,
+    __out ULONG& TimeDateStamp,
+    __out ULONG& SizeOfImage)
+{
+    Base = 0;
+    TimeDateStamp = 0;
+    SizeOfImage = 0;
+    const auto it = m_Modules.find(Module);
+    if (it == m_Modules.end())
+    {
+        m_NumberOfMisses++;
+        return false;
+    }
+    const auto entry = Find(it->second);
+    Wait(*entry);
+    Base = entry->Header.Address;
+    TimeDateStamp = static_cast<ULONG>(entry->Header.Value);
+    SizeOfImage = entry->Header.Size;
+    return entry->Header.Succeeded != 0;
+}
+
+
+bool TraceReplayer::GetNextDifferentlyValidOffset(
+    __in ULONG64 Address,
+    __out ULONG64& NextAddress)
+{
+    NextAddress = 0;
+    const auto it = m_NextOffsets.find(Address);
+    if (it == m_NextOffsets.end())
+    {
+        m_NumberOfMisses++;
+        return false;
+    }
+    const auto entry = Find(it->second);
+    Wait(*entry);
+    NextAddress = entry->Header.Value;
+    return entry->Header.Succeeded != 0;
+}
+
+
+void TraceReplayer::Write(
+    __in const char* Text)
+{
+    m_Output.Write(Text);
+}
+
+
+void TraceReplayer::WriteError(
+    __in const char* Text)
+{
+    m_Output.WriteError(Text);
+}
+
+
+// Returns the next record of the request, or the last one when all of them
+// have been returned
+const TraceReplayer::Record* TraceReplayer::Find(
+    __inout RecordList& List)
+{
+    const auto index = List.Indexes[List.Next];
+    if (List.Next + 1 < List.Indexes.size())
+    {
+        List.Next++;
+    }
+    return &m_Records[index];
+}
+
+
+// Spends the time the request took when it was recorded
+void TraceReplayer::Wait(
+    __in const Record& Entry) const
+{
+    if (!m_SimulateLatency || !Entry.Header.ElapsedMicroseconds)
+    {
+        return;
+    }
+    LARGE_INTEGER start = {}, now = {};
+    QueryPerformanceCounter(&start);
+    const auto ticks = static_cast<LONGLONG>(
+        Entry.Header.ElapsedMicroseconds * m_TicksPerMicrosecond);
+    do
+    {
+        QueryPerformanceCounter(&now);
+    } while (now.QuadPart - start.QuadPart < ticks);
+}
+
+
+namespace {
+
+
+// Returns true when the record is consistent with its kind. Only reads have
+// data, which is never longer than the request, and they read no more bytes
+// than requested.
+bool IsValidRecord(
+    __in const TRACE_RECORD_HEADER& Header)
+{
+    switch (Header.Kind)
+    {
+    case TraceRecordKind::ReadVirtual:
+        return Header.DataLength <= Header.Size &&
+            Header.Value <= Header.Size &&
+            (!Header.DataLength || Header.DataLength == Header.Value);
+    case TraceRecordKind::GetSymbolOffset:
+    case TraceRecordKind::GetTypeSize:
+    case TraceRecordKind::GetFieldOffset:
+    case TraceRecordKind::GetModuleIdentity:
+        return Header.NameLength && !Header.DataLength;
+    case TraceRecordKind::GetPagingMode:
+        return Header.NameLength && !Header.DataLength &&
+            (!Header.Succeeded || Header.Size == 4 || Header.Size == 5);
+    case TraceRecordKind::GetNextDifferentlyValidOffset:
+        return !Header.NameLength && !Header.DataLength;
+    default:
+        return false;
+    }
+}
+
+
+} // End of namespace {unnamed}
@@ -0,0 +1,151 @@
+//
+// This module declears a class responsible for replaying a trace file as a
+// target of the scanner.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "ScanProvider.h"
+#include "TraceFormat.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Serves requests from a trace file recorded by TraceRecorder. A request is
+// answered by the recorded result of the same request; when the same request
+// was recorded more than once, results are returned in the recorded order and
+// the last one is repeated. Requests not in the trace fail.
+class TraceReplayer : public ScanProvider
+{
+public:
+    // Throws std::runtime_error when the file cannot be loaded. When
+    // SimulateLatency is true, each request takes as long as it did when it
+    // was recorded.
+    TraceReplayer(
+        __in ScanProvider& Output,
+        __in const std::string& Path,
+        __in bool SimulateLatency);
+
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes);
+
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset);
+
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size);
+
+    virtual bool GetFieldOffset(
+        __in const char* Type,
+        __in const char* Field,
+        __out ULONG& Offset);
+
+    virtual bool GetPagingMode(
+        __out ULONG& NumberOfLevels,
+        __out ULONG64& SelfMapIndex);
+
+    virtual bool GetModuleIdentity(
+        __in const char* Module,
+        __out ULONG64& Base,
+        __out ULONG& TimeDateStamp,
+        __out ULONG& SizeOfImage);
+
+    virtual bool GetNextDifferentlyValidOffset(
+        __in ULONG64 Address,
+        __out ULONG64& NextAddress);
+
+    virtual void Write(
+        __in const char* Text);
+
+    virtual void WriteError(
+        __in const char* Text);
+
+    SIZE_T GetNumberOfRecords() const { return m_Records.size(); }
+    SIZE_T GetNumberOfMisses() const { return m_NumberOfMisses; }
+
+private:
+    struct Record
+    {
+        TRACE_RECORD_HEADER Header;
+        SIZE_T DataOffset;  // Offset in m_Data
+    };
+
+    // Records of the same request in the recorded order and the index of the
+    // one to return next
+    struct RecordList
+    {
+        std::vector<SIZE_T> Indexes;
+        SIZE_T Next;
+    };
+
+    const Record* Find(
+        __inout RecordList& List);
+
+    void Wait(
+        __in const Record& Entry) const;
+
+    ScanProvider& m_Output;
+    bool m_SimulateLatency;
+    std::vector<Record> m_Records;
+    std::vector<std::uint8_t> m_Data;
+    std::map<std::tuple<ULONG64, ULONG>, RecordList> m_Reads;
+    std::unordered_map<std::string, RecordList> m_Symbols;
+    std::unordered_map<std::string, RecordList> m_Types;
+    std::unordered_map<std::string, RecordList> m_Fields;
+    std::unordered_map<std::string, RecordList> m_PagingModes;
+    std::unordered_map<std::string, RecordList> m_Modules;
+    std::map<ULONG64, RecordList> m_NextOffsets;
+    SIZE_T m_NumberOfMisses;
+    double m_TicksPerMicrosecond;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -6,10 +6,25 @@
 // C/C++ standard headers
 // Other external headers
 // Windows headers
+#include <engextcpp.hpp>
+#include <Psapi.h>
+
 // Original headers
-#include "pte.h"
-#include "Progress.h"
+#include "unique_resource.h"
+#include "scope_guard.h"
 #include "PoolTagDescription.h"
+#include "PageTableSnapshot.h"
+#include "DbgEngProvider.h"
+#include "Scanner.h"
+#include "TraceRecorder.h"
+#include "TraceReplayer.h"
+#include "SymbolCache.h"
+#include "NegativeReadCache.h"
+#include "ElfCoreProvider.h"
+#include "RawMemoryProvider.h"
+#include "RegionWatcher.h"
+#include "PatternMatcher.h"
+#include "ScanSummary.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -29,23 +44,6 @@
 // types
 //
 
-typedef struct _POOL_TRACKER_BIG_PAGES
-{
-    PVOID Va;
-    ULONG Key;
-    ULONG PoolType;
-    SIZE_T Size;    // InBytes
-} POOL_TRACKER_BIG_PAGES, *PPOOL_TRACKER_BIG_PAGES;
-C_ASSERT(sizeof(POOL_TRACKER_BIG_PAGES) == 0x18);
-
-
-struct RandomnessInfo
-{
-    ULONG NumberOfDistinctiveNumbers;
-    ULONG Ramdomness;
-};
-
-
 //----------------------------------------------------------------------------
 //
 // Base extension class.
@@ -60,42 +58,22 @@ class EXT_CLASS : public ExtExtension
 {
 public:
     virtual HRESULT Initialize();
+    virtual void OnSessionInactive(
+        __in ULONG64 Argument);
+    virtual void OnSessionInaccessible(
+        __in ULONG64 Argument);
     EXT_COMMAND_METHOD(findpg);
 
 private:
     void findpgInternal();
 
-    std::vector <std::tuple<POOL_TRACKER_BIG_PAGES, RandomnessInfo>>
-        FindPgPagesFromNonPagedPool();
-
-    std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>>
-        FindPgPagesFromIndependentPages();
+    void watchInternal();
 
-    std::array<HARDWARE_PTE, 512> GetPtes(
-        __in ULONG64 PteBase);
+    ULONG64 GetMaximumMappedBytes();
 
-    bool IsPatchGuardPageAttribute(
-        __in ULONG64 PageBase);
-
-    bool IsPageValidReadWriteExecutable(
-        __in ULONG64 PteAddr);
-
-    // The number of bytes to examine to calculate the number of distinctive
-    // bytes and randomness
-    static const auto EXAMINATION_BYTES = 100;
-
-    // It is not a PatchGuard page if the number of distinctive bytes are bigger
-    // than this number
-    static const auto MAXIMUM_DISTINCTIVE_NUMBER = 5;
-
-    // It is not a PatchGuard page if randomness is smaller than this number
-    static const auto MINIMUM_RANDOMNESS = 50;
-
-    // It is not a PatchGuard page if the size of the page is smaller than this
-    static const auto MINIMUM_REGION_SIZE = 0x004000;
-
-    // It is not a PatchGuard page if the size of the page is larger than this
-    static const auto MAXIMUM_REGION_SIZE = 0xf00000;
+    // Page tables read so far. They are shared by both phases and subsequent
+    // commands until the target runs again.
+    PageTableSnapshot m_PageTables;
 };
 
 
@@ -106,13 +84,9 @@ private:
 
 namespace {
 
-ULONG GetNumberOfDistinctiveNumbers(
-    void* Addr,
-    SIZE_T Size);
+ULONG64 GetThreadCpuMilliseconds();
 
-ULONG GetRamdomness(
-    void* Addr,
-    SIZE_T Size);
+SIZE_T GetPeakWorkingSetSize();
 
 } // End of namespace {unnamed}
 
@@ -173,14 +147,71 @@ HRESULT EXT_CLASS::Initialize()
 }
 
 
-// Exported command !findpg (no options)
+// The target has been detached
+void EXT_CLASS::OnSessionInactive(
+    __in ULONG64 /*Argument*/)
+{
+    m_PageTables.Clear();
+}
+
+
+// The target starts running, so cached page tables will be outdated
+void EXT_CLASS::OnSessionInaccessible(
+    __in ULONG64 /*Argument*/)
+{
+    m_PageTables.Clear();
+}
+
+
+// Exported command !findpg [-budget <seconds>] [-record <file>]
+//                          [-replay <file> [-latency]] [-nocache]
+//                          [-elfcore <file> [-rsslimit <MB>]] [-timers]
+//                          [-patterns [-sigfile <file>]]
+//                          [-sample <fraction> [-seed <value>]]
+//        !findpg -watch <file> -cr3 <value> [-lowmem <MB>]
+//                [-interval <seconds>] [-cpu <percent>] [-rsslimit <MB>]
 EXT_COMMAND(findpg,
     "Displays base addresses of PatchGuard pages",
-    "")
+    "{budget;e,o;seconds;Stop analysis after the given number of seconds and "
+    "display results found so far}"
+    "{record;s,o;file;Record all reads of the target into a trace file}"
+    "{replay;s,o;file;Analyze a trace file recorded by -record instead of "
+    "the target}"
+    "{latency;b,o;;Make each read of -replay take as long as it did when it "
+    "was recorded}"
+    "{nocache;b,o;;Resolve symbols without the symbol cache}"
+    "{timers;b,o;;Only analyze pages referenced by timers, which completes "
+    "in seconds}"
+    "{patterns;b,o;;Also search RWX pages for code and contexts of "
+    "PatchGuard that are not encrypted}"
+    "{sigfile;s,o;file;Search patterns in the file instead of the built-in "
+    "ones for -patterns}"
+    "{elfcore;s,o;file;Analyze an ELF core file of a virtual machine instead "
+    "of the target}"
+    "{watch;s,o;file;Keep analyzing a memory file of a running virtual "
+    "machine and display changes}"
+    "{cr3;e,o;value;CR3 of the virtual machine for -watch}"
+    "{lowmem;e,o;MB;Size of RAM below 4GB (below_4g_mem_size of QEMU) in the "
+    "file for -watch when the virtual machine has RAM above 4GB}"
+    "{interval;e,o;seconds;Minimum interval of analysis for -watch "
+    "(default 10)}"
+    "{cpu;e,o;percent;Maximum CPU usage of -watch (default 10)}"
+    "{rsslimit;e,o;MB;Maximum size of a file mapped at once for -elfcore and "
+    "-watch (default 1024)}"
+    "{sample;s,o;fraction;Only analyze the given fraction (0-1) of the "
+    "memory at random and estimate the number of PatchGuard regions}"
+    "{seed;e,o;value;Seed selecting samples for -sample (default 0)}")
 {
     try
     {
-        findpgInternal();
+        if (HasArg("watch"))
+        {
+            watchInternal();
+        }
+        else
+        {
+            findpgInternal();
+        }
     }
     catch (std::exception& e)
     {
@@ -197,25 +228,130 @@ void EXT_CLASS::findpgInternal()
     Out("Wait until analysis is completed. It typically takes 2-5 minutes.\n");
     Out("Or press Ctrl+Break or [Debug] > [Break] to stop analysis.\n");
 
-    // Collect PatchGuard pages from NonPagedPool and independent pages
-    auto foundNonPaged = FindPgPagesFromNonPagedPool();
-    Out("Phase 1 analysis has been done.\n");
-    auto foundIndependent = FindPgPagesFromIndependentPages();
-    Out("Phase 2 analysis has been done.\n");
+    // The target never stops in local kernel debugging, so page tables cannot
+    // be reused across commands
+    if (m_DebuggeeClass == DEBUG_CLASS_KERNEL &&
+        m_DebuggeeQual == DEBUG_KERNEL_LOCAL)
+    {
+        m_PageTables.Clear();
+    }
+
+    ScanOptions options = {};
+    if (HasArg("budget"))
+    {
+        options.Deadline = GetTickCount64() + GetArgU64("budget") * 1000;
+    }
+    options.TimersOnly = HasArg("timers");
+    if (HasArg("sample"))
+    {
+        const auto fraction = GetArgStr("sample");
+        char* end = nullptr;
+        options.SampleFraction = strtod(fraction, &end);
+        if (end == fraction || *end != '\0' ||
+            !(options.SampleFraction > 0.0 && options.SampleFraction <= 1.0))
+        {
+            throw std::runtime_error(
+                "-sample requires a fraction greater than 0 and up to 1.");
+        }
+        options.Seed = (HasArg("seed")) ? GetArgU64("seed") : 0;
+    }
+    PatternMatcher patterns;
+    if (HasArg("patterns") || HasArg("sigfile"))
+    {
+        if (HasArg("sigfile"))
+        {
+            patterns.LoadFile(GetArgStr("sigfile"));
+        }
+        else
+        {
+            patterns.AddDefaultPatterns();
+        }
+        options.Patterns = &patterns;
+    }
+
+    // Page tables cached by earlier commands are used only when the target
+    // itself is analyzed. A trace has to contain all reads of the scan, and
+    // other sources have page tables unrelated to the target.
+    DbgEngProvider provider(this);
+    PageTableSnapshot localPageTables;
+    std::unique_ptr<TraceRecorder> recorder;
+    std::unique_ptr<TraceReplayer> replayer;
+    std::unique_ptr<ElfCoreProvider> elfCore;
+    ScanProvider* target = &provider;
+    auto pageTables = &m_PageTables;
+    if (HasArg("elfcore"))
+    {
+        elfCore.reset(new ElfCoreProvider(provider, GetArgStr("elfcore"),
+            GetMaximumMappedBytes()));
+        Out("Loaded %Iu segments. CR3 = %016I64x\n",
+            elfCore->GetNumberOfSegments(), elfCore->GetDirectoryTableBase());
+        target = elfCore.get();
+        pageTables = &localPageTables;
+    }
+    if (HasArg("replay"))
+    {
+        replayer.reset(new TraceReplayer(provider, GetArgStr("replay"),
+            HasArg("latency")));
+        Out("Replaying %Iu records.\n", replayer->GetNumberOfRecords());
+        target = replayer.get();
+        pageTables = &localPageTables;
+    }
+    else if (HasArg("record"))
+    {
+        recorder.reset(new TraceRecorder(*target, GetArgStr("record")));
+        target = recorder.get();
+        pageTables = &localPageTables;
+    }
+
+    // Symbols are resolved from the cache unless a trace is involved, in
+    // which case all lookups have to go through the trace
+    std::unique_ptr<SymbolCache> symbols;
+    if (!HasArg("nocache") && target == &provider)
+    {
+        symbols.reset(new SymbolCache(provider));
+        target = symbols.get();
+    }
+    NegativeReadCache unreadable(*target);
+    target = &unreadable;
 
-    // Sort data according to its base addresses
-    std::sort(foundNonPaged.begin(), foundNonPaged.end(), [](
-        const decltype(foundNonPaged)::value_type& Lhs,
-        const decltype(foundNonPaged)::value_type& Rhs)
+    Scanner scanner(*target, *pageTables, options);
+    const auto found = scanner.Scan();
+    if (recorder)
     {
-        return std::get<0>(Lhs).Va < std::get<0>(Rhs).Va;
-    });
-    std::sort(foundIndependent.begin(), foundIndependent.end(), [](
-        const decltype(foundIndependent)::value_type& Lhs,
-        const decltype(foundIndependent)::value_type& Rhs)
+        Out("%Iu records have been written.\n",
+            recorder->GetNumberOfRecords());
+    }
+    if (replayer)
     {
-        return std::get<0>(Lhs) < std::get<0>(Rhs);
-    });
+        Out("%Iu requests were not found in the trace.\n",
+            replayer->GetNumberOfMisses());
+    }
+    Out("Unreadable ranges: %Iu reads skipped, %Iu reads failed, %Iu"
+        " ranges known.\n", unreadable.GetNumberOfHits(),
+        unreadable.GetNumberOfMisses(), unreadable.GetNumberOfRanges());
+    if (symbols)
+    {
+        Out("Symbol cache: %Iu hits, %Iu misses.\n",
+            symbols->GetNumberOfHits(), symbols->GetNumberOfMisses());
+    }
+    if (elfCore)
+    {
+        ULONG64 elapsedMs = 0;
+        for (const auto& phase : found.Statistics)
+        {
+            elapsedMs += phase.ElapsedMilliseconds;
+        }
+        const auto& file = elfCore->GetFile();
+        Out("File: %I64u MB read at %.1f MB/s, %Iu windows mapped within"
+            " %I64u MB, peak working set %Iu MB.\n",
+            elfCore->GetNumberOfBytesRead() / 1024 / 1024,
+            (elapsedMs) ? elfCore->GetNumberOfBytesRead() * 1000.0
+                / elapsedMs / 1024 / 1024 : 0.0,
+            file.GetNumberOfMaps(), file.GetMaximumMappedBytes() / 1024 / 1024,
+            GetPeakWorkingSetSize() / 1024 / 1024);
+    }
+    const auto& foundNonPaged = found.BigPagePool;
+    const auto& foundIndependent = found.Independent;
 
     // Display collected data
     PoolTagDescription pooltag(this);
@@ -237,363 +373,147 @@ void EXT_CLASS::findpgInternal()
             std::get<2>(n).NumberOfDistinctiveNumbers,
             std::get<2>(n).Ramdomness);
     }
-}
-
-// Collects PatchGuard pages reside in NonPagedPool
-std::vector <std::tuple<POOL_TRACKER_BIG_PAGES, RandomnessInfo>>
-EXT_CLASS::FindPgPagesFromNonPagedPool()
-{
-    ULONG64 offset = 0;
-
-    // Read MmNonPagedPoolStart if it is possible. On Windows 8.1, this symbol
-    // has been removed and this magic value is used instead.
-    ULONG64 mmNonPagedPoolStart = 0xFFFFE00000000000;
-    auto result = m_Symbols->GetOffsetByName("nt!MmNonPagedPoolStart", &offset);
-    if (SUCCEEDED(result))
+    for (const auto& n : found.LargePage)
     {
-        result = m_Data->ReadPointersVirtual(1, offset, &mmNonPagedPoolStart);
-        if (!SUCCEEDED(result))
-        {
-            throw std::runtime_error("nt!MmNonPagedPoolStart could not be read.");
-        }
+        Out("[LargePage] PatchGuard context page base: %y, Size: 0x%08x,"
+            " Randomness %3d:%3d,\n",
+            std::get<0>(n), std::get<1>(n),
+            std::get<2>(n).NumberOfDistinctiveNumbers,
+            std::get<2>(n).Ramdomness);
     }
-
-    // Read PoolBigPageTableSize
-    result = m_Symbols->GetOffsetByName("nt!PoolBigPageTableSize", &offset);
-    if (!SUCCEEDED(result))
+    for (const auto& n : found.Timer)
     {
-        throw std::runtime_error("nt!PoolBigPageTableSize could not be found.");
+        Out("[Timer] PatchGuard context page base: %y, Size: 0x%08x,"
+            " Randomness %3d:%3d, Timer: %y\n",
+            std::get<0>(n), std::get<1>(n),
+            std::get<2>(n).NumberOfDistinctiveNumbers,
+            std::get<2>(n).Ramdomness, std::get<3>(n));
     }
-    SIZE_T poolBigPageTableSize = 0;
-    result = m_Data->ReadPointersVirtual(1, offset, &poolBigPageTableSize);
-    if (!SUCCEEDED(result))
+    for (const auto& n : found.Decrypted)
     {
-        throw std::runtime_error("nt!PoolBigPageTableSize could not be read.");
+        Out("[Decrypted] PatchGuard code or context at %y, Pattern: %s\n",
+            std::get<0>(n), patterns.GetName(std::get<1>(n)).c_str());
     }
+    DisplaySummary(provider, found.Statistics, *pageTables);
+}
 
-    // Read PoolBigPageTable
-    result = m_Symbols->GetOffsetByName("nt!PoolBigPageTable", &offset);
-    if (!SUCCEEDED(result))
-    {
-        throw std::runtime_error("nt!PoolBigPageTable could not be found.");
-    }
-    ULONG64 poolBigPageTable = 0;
-    result = m_Data->ReadPointersVirtual(1, offset, &poolBigPageTable);
-    if (!SUCCEEDED(result))
-    {
-        throw std::runtime_error("nt!PoolBigPageTable could not be read.");
-    }
 
-    // Read actual PoolBigPageTable contents
-    ULONG readBytes = 0;
-    std::vector<POOL_TRACKER_BIG_PAGES> table(poolBigPageTableSize);
-    result = m_Data->ReadVirtual(poolBigPageTable, table.data(),
-        static_cast<ULONG>(table.size() * sizeof(POOL_TRACKER_BIG_PAGES)),
-        &readBytes);
-    if (!SUCCEEDED(result))
+// Analyzes a memory file of a running virtual machine repeatedly without
+// stopping it and displays PatchGuard pages appeared and disappeared since
+// the previous analysis until Ctrl+Break is pressed. Analysis is delayed so
+// that it does not use more CPU time than the given percentage.
+void EXT_CLASS::watchInternal()
+{
+    if (!HasArg("cr3"))
     {
-        throw std::runtime_error("nt!PoolBigPageTable could not be read.");
+        throw std::runtime_error("-watch requires -cr3.");
     }
-
-    // Walk BigPageTable
-    Progress progress(this);
-    std::vector<std::tuple<POOL_TRACKER_BIG_PAGES, RandomnessInfo>> found;
-    for (SIZE_T i = 0; i < poolBigPageTableSize; ++i)
+    const auto intervalMs = ((HasArg("interval"))
+        ? GetArgU64("interval") : 10) * 1000;
+    const auto cpuPercent = (std::max)(1ull, (std::min)(100ull,
+        (HasArg("cpu")) ? GetArgU64("cpu") : 10ull));
+
+    DbgEngProvider output(this);
+    RawMemoryProvider memory(output, GetArgStr("watch"), GetArgU64("cr3"),
+        ((HasArg("lowmem")) ? GetArgU64("lowmem") : 0) * 1024 * 1024,
+        GetMaximumMappedBytes());
+    memory.SetQuiet(true);
+    ScanOptions options = {};
+    options.IsCancelled = [this]()
     {
-        if ((i % 0x1000) == 0)
-        {
-            ++progress;
-        }
-
-        const auto& entry = table[i];
-        auto startAddr = reinterpret_cast<ULONG_PTR>(entry.Va);
+        return m_Control->GetInterrupt() == S_OK;
+    };
 
-        // Ignore unused entries
-        if (!startAddr || (startAddr & 1))
+    Out("Watching. Press Ctrl+Break or [Debug] > [Break] to stop.\n");
+    RegionWatcher watcher;
+    for (ULONG64 iteration = 1;; ++iteration)
+    {
+        const auto cpuStart = GetThreadCpuMilliseconds();
+
+        // Memory keeps changing, so nothing is carried over between scans
+        PageTableSnapshot pageTables;
+        NegativeReadCache unreadable(memory);
+        Scanner scanner(unreadable, pageTables, options);
+        const auto found = scanner.Scan();
+        if (m_Control->GetInterrupt() == S_OK)
         {
-            continue;
+            break;
         }
 
-        // Filter by the size of region
-        if (MINIMUM_REGION_SIZE > entry.Size || entry.Size > MAXIMUM_REGION_SIZE)
-        {
-            continue;
-        }
+        const auto cpuMs = GetThreadCpuMilliseconds() - cpuStart;
 
-        // Filter by the address
-        if (startAddr < mmNonPagedPoolStart)
+        std::vector<RegionWatcher::Region> added, removed;
+        watcher.Update(found, added, removed);
+        for (const auto& n : added)
         {
-            // This assertion seem reasonable but not always be true.
-            //assert(entry.PoolType & 1 /*PagedPool*/);
-            continue;
+            Out("+ [%s] PatchGuard context page base: %y, Size: 0x%08I64x\n",
+                n.Kind, n.Base, n.Size);
         }
-
-        // Filter by the page protection
-        if (!IsPatchGuardPageAttribute(startAddr))
+        for (const auto& n : removed)
         {
-            continue;
+            Out("- [%s] PatchGuard context page base: %y, Size: 0x%08I64x\n",
+                n.Kind, n.Base, n.Size);
         }
-
-        // Read and check randomness of the contents
-        std::array<std::uint8_t, EXAMINATION_BYTES> contents;
-        result = m_Data->ReadVirtual(startAddr,
-            contents.data(), static_cast<ULONG>(contents.size()), &readBytes);
-        if (!SUCCEEDED(result))
+        Out("FINDPG_WATCH Iteration=%I64u Regions=%Iu CpuMs=%I64u\n",
+            iteration, watcher.GetNumberOfRegions(), cpuMs);
+
+        // Wait at least for the interval, and longer when the scan used more
+        // CPU time than the budget allows
+        const auto waitMs = (std::max)(intervalMs,
+            cpuMs * (100 - cpuPercent) / cpuPercent);
+        const auto wakeUp = GetTickCount64() + waitMs;
+        while (GetTickCount64() < wakeUp &&
+            m_Control->GetInterrupt() != S_OK)
         {
-            continue;
+            Sleep(100);
         }
-        const auto numberOfDistinctiveNumbers = GetNumberOfDistinctiveNumbers(
-            contents.data(), EXAMINATION_BYTES);
-        const auto randomness = GetRamdomness(
-            contents.data(), EXAMINATION_BYTES);
-        if (numberOfDistinctiveNumbers > MAXIMUM_DISTINCTIVE_NUMBER ||
-            randomness < MINIMUM_RANDOMNESS)
+        if (m_Control->GetInterrupt() == S_OK)
         {
-            continue;
+            break;
         }
-
-        // It seems to be a PatchGuard page
-        found.emplace_back(entry,
-            RandomnessInfo{ numberOfDistinctiveNumbers, randomness,});
     }
-    return found;
+    Out("Watching has been stopped.\n");
 }
 
 
-// Collects PatchGuard pages reside in independent pages
-std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>>
-EXT_CLASS::FindPgPagesFromIndependentPages()
+// Returns the maximum size of a file mapped at once given by -rsslimit
+ULONG64 EXT_CLASS::GetMaximumMappedBytes()
 {
-    ULONG64 offset = 0;
-
-    // MmSystemRangeStart
-    auto result = m_Symbols->GetOffsetByName("nt!MmSystemRangeStart", &offset);
-    if (!SUCCEEDED(result))
-    {
-        throw std::runtime_error("nt!MmSystemRangeStart could not be found.");
-    }
-    ULONG64 mmSystemRangeStart = 0;
-    result = m_Data->ReadPointersVirtual(1, offset, &mmSystemRangeStart);
-    if (!SUCCEEDED(result))
-    {
-        throw std::runtime_error("nt!MmSystemRangeStart could not be read.");
-    }
-
-    std::vector<std::tuple<ULONG64, SIZE_T, RandomnessInfo>> found;
-
-    Progress progress(this);
-
-    // Walk entire page table (PXE -> PPE -> PDE -> PTE)
-    // Start parse PXE (PML4) which represents the beginning of kernel address
-    const auto startPxe = reinterpret_cast<ULONG64>(
-        MiAddressToPxe(reinterpret_cast<void*>(mmSystemRangeStart)));
-    const auto endPxe = PXE_TOP;
-    const auto pxes = GetPtes(PXE_BASE);
-    for (auto currentPxe = startPxe; currentPxe < endPxe;
-        currentPxe += sizeof(HARDWARE_PTE))
-    {
-        // Make sure that this PXE is valid
-        const auto pxeIndex = (currentPxe - PXE_BASE) / sizeof(HARDWARE_PTE);
-        const auto pxe = pxes[pxeIndex];
-        if (!pxe.Valid)
-        {
-            continue;
-        }
-
-        // If the PXE is valid, analyze PPE belonging to this
-        const auto startPpe = PPE_BASE + 0x1000 * pxeIndex;
-        const auto endPpe   = PPE_BASE + 0x1000 * (pxeIndex + 1);
-        const auto ppes = GetPtes(startPpe);
-        for (auto currentPpe = startPpe; currentPpe < endPpe;
-            currentPpe += sizeof(HARDWARE_PTE))
-        {
-            // Make sure that this PPE is valid
-            const auto ppeIndex1 = (currentPpe - PPE_BASE) / sizeof(HARDWARE_PTE);
-            const auto ppeIndex2 = (currentPpe - startPpe) / sizeof(HARDWARE_PTE);
-            const auto ppe = ppes[ppeIndex2];
-            if (!ppe.Valid)
-            {
-                continue;
-            }
-
-            // If the PPE is valid, analyze PDE belonging to this
-            const auto startPde = PDE_BASE + 0x1000 * ppeIndex1;
-            const auto endPde   = PDE_BASE + 0x1000 * (ppeIndex1 + 1);
-            const auto pdes = GetPtes(startPde);
-            for (auto currentPde = startPde; currentPde < endPde;
-                currentPde += sizeof(HARDWARE_PTE))
-            {
-                // Make sure that this PDE is valid as well as is not handling
-                // a large page as an independent page does not use a large page
-                const auto pdeIndex1 = (currentPde - PDE_BASE) / sizeof(HARDWARE_PTE);
-                const auto pdeIndex2 = (currentPde - startPde) / sizeof(HARDWARE_PTE);
-                const auto pde = pdes[pdeIndex2];
-                if (!pde.Valid || pde.LargePage)
-                {
-                    continue;
-                }
-                ++progress;
-
-                // If the PDE is valid, analyze PTE belonging to this
-                const auto startPte = PTE_BASE + 0x1000 * pdeIndex1;
-                const auto endPte   = PTE_BASE + 0x1000 * (pdeIndex1 + 1);
-                const auto ptes = GetPtes(startPte);
-                for (auto currentPte = startPte; currentPte < endPte;
-                    currentPte += sizeof(HARDWARE_PTE))
-                {
-                    // Make sure that this PPE is valid,
-                    // Readable/Writable/Executable
-                    const auto pteIndex2 = (currentPte - startPte)
-                        / sizeof(HARDWARE_PTE);
-                    const auto pte = ptes[pteIndex2];
-                    if (!pte.Valid ||
-                        !pte.Write ||
-                        pte.NoExecute)
-                    {
-                        continue;
-                    }
-
-                    // This page might be PatchGuard page, so let's analyze it
-                    const auto virtualAddress = reinterpret_cast<ULONG64>(
-                        MiPteToAddress(
-                            reinterpret_cast<HARDWARE_PTE*>(currentPte)))
-                                | 0xffff000000000000;
-
-                    // Read the contents of the address that is managed by the
-                    // PTE
-                    ULONG readBytes = 0;
-                    std::array<std::uint8_t, EXAMINATION_BYTES + sizeof(ULONG64)>
-                        contents;
-                    result = m_Data->ReadVirtual(virtualAddress, contents.data(),
-                        static_cast<ULONG>(contents.size()), &readBytes);
-                    if (!SUCCEEDED(result))
-                    {
-                        continue;
-                    }
-
-                    // Check randomness of the contents
-                    const auto numberOfDistinctiveNumbers =
-                        GetNumberOfDistinctiveNumbers(
-                            contents.data() + sizeof(ULONG64), EXAMINATION_BYTES);
-                    const auto randomness = GetRamdomness(
-                        contents.data() + sizeof(ULONG64), EXAMINATION_BYTES);
-                    if (numberOfDistinctiveNumbers > MAXIMUM_DISTINCTIVE_NUMBER
-                        || randomness < MINIMUM_RANDOMNESS)
-                    {
-                        continue;
-                    }
-
-                    // Also, check the size of the region. The first page of
-                    // allocated pages as independent pages has its own page
-                    // size in bytes at the first 8 bytes
-                    const auto independentPageSize =
-                        *reinterpret_cast<ULONG64*>(contents.data());
-                    if (MINIMUM_REGION_SIZE > independentPageSize
-                     || independentPageSize > MAXIMUM_REGION_SIZE)
-                    {
-                        continue;
-                    }
-
-                    // It seems to be a PatchGuard page
-                    found.emplace_back(virtualAddress, independentPageSize,
-                        RandomnessInfo{ numberOfDistinctiveNumbers, randomness, });
-                }
-            }
-        }
-    }
-    return found;
-}
-
-
-// Returns PTEs in one page
-std::array<HARDWARE_PTE, 512> EXT_CLASS::GetPtes(
-    __in ULONG64 PteBase)
-{
-    ULONG readBytes = 0;
-    std::array<HARDWARE_PTE, 512> ptes;
-    auto result = m_Data->ReadVirtual(PteBase, ptes.data(),
-        static_cast<ULONG>(ptes.size() * sizeof(HARDWARE_PTE)), &readBytes);
-    if (!SUCCEEDED(result))
-    {
-        throw std::runtime_error("The given address could not be read.");
-    }
-    return ptes;
-}
-
-
-// Returns true when page protection of the given page or a parant page
-// of the given page is Valid and Readable/Writable/Executable.
-bool EXT_CLASS::IsPatchGuardPageAttribute(
-    __in ULONG64 PageBase)
-{
-    const auto pteAddr = MiAddressToPte(reinterpret_cast<void*>(PageBase));
-    if (IsPageValidReadWriteExecutable(reinterpret_cast<ULONG64>(pteAddr)))
-    {
-        return true;
-    }
-    const auto pdeAddr = MiAddressToPde(reinterpret_cast<void*>(PageBase));
-    if (IsPageValidReadWriteExecutable(reinterpret_cast<ULONG64>(pdeAddr)))
-    {
-        return true;
-    }
-    return false;
-}
-
-
-// Returns true when page protection of the given page is
-// Readable/Writable/Executable.
-bool EXT_CLASS::IsPageValidReadWriteExecutable(
-    __in ULONG64 PteAddr)
-{
-    ULONG readBytes = 0;
-    HARDWARE_PTE pte = {};
-    auto result = m_Data->ReadVirtual(PteAddr,
-        &pte, sizeof(pte), &readBytes);
-    if (!SUCCEEDED(result))
-    {
-        return false;
-    }
-    return pte.Valid
-        && pte.Write
-        && !pte.NoExecute;
+    return ((HasArg("rsslimit")) ? GetArgU64("rsslimit") : 1024)
+        * 1024 * 1024;
 }
 
 
 namespace {
 
 
-// Returns the number of 0x00 and 0xff in the given range
-ULONG GetNumberOfDistinctiveNumbers(
-    __in void* Addr,
-    __in SIZE_T Size)
+// Returns the peak working set size of the process in bytes
+SIZE_T GetPeakWorkingSetSize()
 {
-    const auto p = static_cast<UCHAR*>(Addr);
-    ULONG count = 0;
-    for (SIZE_T i = 0; i < Size; ++i)
+    PROCESS_MEMORY_COUNTERS counters = { sizeof(counters) };
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+        sizeof(counters)))
     {
-        if (p[i] == 0xff || p[i] == 0x00)
-        {
-            count++;
-        }
+        return 0;
     }
-    return count;
+    return counters.PeakWorkingSetSize;
 }
 
 
-// Returns the number of unique bytes in the given range.
-// For example, it returns 3 for the following bytes
-// 00 01 01 02 02 00 02
-ULONG GetRamdomness(
-    __in void* Addr,
-    __in SIZE_T Size)
+// Returns CPU time the current thread has used in milliseconds
+ULONG64 GetThreadCpuMilliseconds()
 {
-    const auto p = static_cast<UCHAR*>(Addr);
-    std::set<UCHAR> dic;
-    for (SIZE_T i = 0; i < Size; ++i)
+    FILETIME creation = {}, exit = {}, kernel = {}, user = {};
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
     {
-        dic.insert(p[i]);
+        return 0;
     }
-    return static_cast<ULONG>(dic.size());
+    ULARGE_INTEGER kernelTime = {}, userTime = {};
+    kernelTime.LowPart = kernel.dwLowDateTime;
+    kernelTime.HighPart = kernel.dwHighDateTime;
+    userTime.LowPart = user.dwLowDateTime;
+    userTime.HighPart = user.dwHighDateTime;
+    return (kernelTime.QuadPart + userTime.QuadPart) / 10000;
 }
 
 
@@ -16,16 +16,16 @@
 // macro utilities
 //
 
-static const auto PXE_BASE    = 0xFFFFF6FB7DBED000UI64;
-static const auto PXE_SELFMAP = 0xFFFFF6FB7DBEDF68UI64;
-static const auto PPE_BASE    = 0xFFFFF6FB7DA00000UI64;
-static const auto PDE_BASE    = 0xFFFFF6FB40000000UI64;
-static const auto PTE_BASE    = 0xFFFFF68000000000UI64;
+static const auto PXE_BASE    = 0xFFFFF6FB7DBED000ULL;
+static const auto PXE_SELFMAP = 0xFFFFF6FB7DBEDF68ULL;
+static const auto PPE_BASE    = 0xFFFFF6FB7DA00000ULL;
+static const auto PDE_BASE    = 0xFFFFF6FB40000000ULL;
+static const auto PTE_BASE    = 0xFFFFF68000000000ULL;
 
-static const auto PXE_TOP     = 0xFFFFF6FB7DBEDFFFUI64;
-static const auto PPE_TOP     = 0xFFFFF6FB7DBFFFFFUI64;
-static const auto PDE_TOP     = 0xFFFFF6FB7FFFFFFFUI64;
-static const auto PTE_TOP     = 0xFFFFF6FFFFFFFFFFUI64;
+static const auto PXE_TOP     = 0xFFFFF6FB7DBEDFFFULL;
+static const auto PPE_TOP     = 0xFFFFF6FB7DBFFFFFULL;
+static const auto PDE_TOP     = 0xFFFFF6FB7FFFFFFFULL;
+static const auto PTE_TOP     = 0xFFFFF6FFFFFFFFFFULL;
 
 static const auto PTI_SHIFT = 12;
 static const auto PDI_SHIFT = 21;
@@ -159,3 +159,12 @@ PHARDWARE_PTE MiAddressToPte(
     return reinterpret_cast<PHARDWARE_PTE>(PTE_BASE + Offset);
 }
 
+
+// Returns a page frame number including bits above the PageFrameNumber field
+inline
+ULONG64 MiGetPageFrameNumber(
+    __in const HARDWARE_PTE& Pte)
+{
+    return (*reinterpret_cast<const ULONG64*>(&Pte) >> PTI_SHIFT)
+        & 0xFFFFFFFFFFULL;
+}
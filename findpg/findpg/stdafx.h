@@ -9,23 +9,26 @@
 // C/C++ standard headers
 #include <cassert>
 #include <cstdint>
+#include <algorithm>
 #include <array>
 #include <memory>
 #include <sstream>
 #include <iomanip>
+#include <map>
 #include <string>
+#include <tuple>
 #include <vector>
 #include <utility>
 #include <set>
+#include <unordered_map>
 
 // Other external headers
 // Windows headers
-#include <tchar.h>
-#include <engextcpp.hpp>
+// The debugger SDK is included only by modules of the extension so that the
+// scan core builds without it
+#include <Windows.h>
 
 // Original headers
-#include "unique_resource.h"
-#include "scope_guard.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
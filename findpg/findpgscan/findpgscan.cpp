@@ -0,0 +1,332 @@
+//
+// This module implements findpgscan, a command line tool finding PatchGuard
+// pages in an ELF core file, a memory file of a virtual machine or a trace
+// file without a debugger, so that they can be analyzed headlessly on Linux.
+//
+#include "stdafx.h"
+
+// C/C++ standard headers
+#include <cstdio>
+#include <exception>
+#include <string>
+
+// Other external headers
+// Windows headers
+// Original headers
+#include "ElfCoreProvider.h"
+#include "NegativeReadCache.h"
+#include "PageTableSnapshot.h"
+#include "PatternMatcher.h"
+#include "RawMemoryProvider.h"
+#include "ScanProvider.h"
+#include "ScanSummary.h"
+#include "Scanner.h"
+#include "TraceReplayer.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+namespace {
+
+const char USAGE[] =
+    "Usage: findpgscan -elfcore <file> [options]\n"
+    "       findpgscan -raw <file> -cr3 <value> [-lowmem <MB>] [options]\n"
+    "       findpgscan -replay <file> [options]\n"
+    "Options:\n"
+    "  -budget <seconds>  Stop analysis after the given number of seconds\n"
+    "  -rsslimit <MB>     Maximum size of a file mapped at once (default "
+    "1024)\n"
+    "  -patterns          Also search RWX pages for code and contexts of\n"
+    "                     PatchGuard that are not encrypted\n";
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+namespace {
+
+// Arguments given in the same form as those of !findpg
+struct Arguments
+{
+    std::string ElfCore;
+    std::string Raw;
+    std::string Replay;
+    ULONG64 Cr3;
+    ULONG64 LowMemMb;
+    ULONG64 BudgetSeconds;
+    ULONG64 RssLimitMb;
+    bool SearchesPatterns;
+};
+
+
+// Displays messages on stdout and errors on stderr. The tool has no target
+// of its own, so symbols and memory are never available through it.
+class ConsoleProvider : public ScanProvider
+{
+public:
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes)
+    {
+        UNREFERENCED_PARAMETER(Address);
+        UNREFERENCED_PARAMETER(Buffer);
+        UNREFERENCED_PARAMETER(Size);
+        if (ReadBytes)
+        {
+            *ReadBytes = 0;
+        }
+        return false;
+    }
+
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset)
+    {
+        UNREFERENCED_PARAMETER(Symbol);
+        Offset = 0;
+        return false;
+    }
+
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size)
+    {
+        UNREFERENCED_PARAMETER(Type);
+        Size = 0;
+        return false;
+    }
+
+    virtual void Write(
+        __in const char* Text)
+    {
+        std::fputs(Text, stdout);
+        std::fflush(stdout);
+    }
+
+    virtual void WriteError(
+        __in const char* Text)
+    {
+        std::fputs(Text, stderr);
+    }
+};
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+Arguments ParseArguments(
+    __in int Argc,
+    __in char* Argv[]);
+
+void Scan(
+    __in const Arguments& Args);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+int main(
+    __in int Argc,
+    __in char* Argv[])
+{
+    try
+    {
+        Scan(ParseArguments(Argc, Argv));
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
+
+
+namespace {
+
+// Throws std::runtime_error with the usage when arguments are invalid
+Arguments ParseArguments(
+    __in int Argc,
+    __in char* Argv[])
+{
+    Arguments args = {};
+    args.RssLimitMb = 1024;
+    auto hasCr3 = false;
+    for (int i = 1; i < Argc; ++i)
+    {
+        const std::string name = Argv[i];
+        if (name == "-patterns")
+        {
+            args.SearchesPatterns = true;
+            continue;
+        }
+        if (i + 1 >= Argc)
+        {
+            throw std::runtime_error(std::string(USAGE));
+        }
+        const std::string value = Argv[++i];
+        if (name == "-elfcore")
+        {
+            args.ElfCore = value;
+        }
+        else if (name == "-raw")
+        {
+            args.Raw = value;
+        }
+        else if (name == "-replay")
+        {
+            args.Replay = value;
+        }
+        else if (name == "-cr3")
+        {
+            args.Cr3 = std::stoull(value, nullptr, 0);
+            hasCr3 = true;
+        }
+        else if (name == "-lowmem")
+        {
+            args.LowMemMb = std::stoull(value, nullptr, 0);
+        }
+        else if (name == "-budget")
+        {
+            args.BudgetSeconds = std::stoull(value, nullptr, 0);
+        }
+        else if (name == "-rsslimit")
+        {
+            args.RssLimitMb = std::stoull(value, nullptr, 0);
+        }
+        else
+        {
+            throw std::runtime_error(std::string(USAGE));
+        }
+    }
+
+    const auto numberOfSources = !args.ElfCore.empty() + !args.Raw.empty()
+        + !args.Replay.empty();
+    if (numberOfSources != 1 || hasCr3 != !args.Raw.empty())
+    {
+        throw std::runtime_error(std::string(USAGE));
+    }
+    return args;
+}
+
+
+// Scans the source given by Args and displays regions found and a summary in
+// the same form as !findpg
+void Scan(
+    __in const Arguments& Args)
+{
+    ConsoleProvider console;
+    PatternMatcher patterns;
+    ScanOptions options = {};
+    if (Args.BudgetSeconds)
+    {
+        options.Deadline = GetTickCount64() + Args.BudgetSeconds * 1000;
+    }
+    if (Args.SearchesPatterns)
+    {
+        patterns.AddDefaultPatterns();
+        options.Patterns = &patterns;
+    }
+
+    const auto maximumMappedBytes = Args.RssLimitMb * 1024 * 1024;
+    std::unique_ptr<ScanProvider> target;
+    if (!Args.ElfCore.empty())
+    {
+        auto elfCore = new ElfCoreProvider(console, Args.ElfCore,
+            maximumMappedBytes);
+        target.reset(elfCore);
+        console.Out("Loaded %Iu segments. CR3 = %016I64x\n",
+            elfCore->GetNumberOfSegments(), elfCore->GetDirectoryTableBase());
+    }
+    else if (!Args.Raw.empty())
+    {
+        target.reset(new RawMemoryProvider(console, Args.Raw, Args.Cr3,
+            Args.LowMemMb * 1024 * 1024, maximumMappedBytes));
+    }
+    else
+    {
+        auto replayer = new TraceReplayer(console, Args.Replay, false);
+        target.reset(replayer);
+        console.Out("Replaying %Iu records.\n",
+            replayer->GetNumberOfRecords());
+    }
+
+    PageTableSnapshot pageTables;
+    NegativeReadCache unreadable(*target);
+    Scanner scanner(unreadable, pageTables, options);
+    const auto found = scanner.Scan();
+
+    for (const auto& n : found.BigPagePool)
+    {
+        console.Out("[BigPagePool] PatchGuard context page base: %016I64x,"
+            " size: 0x%08I64x, Randomness %3d:%3d,\n",
+            std::get<0>(n).Va, std::get<0>(n).Size,
+            std::get<1>(n).NumberOfDistinctiveNumbers,
+            std::get<1>(n).Ramdomness);
+    }
+    for (const auto& n : found.Independent)
+    {
+        console.Out("[Independent] PatchGuard context page base: %016I64x,"
+            " Size: 0x%08Ix, Randomness %3d:%3d,\n",
+            std::get<0>(n), std::get<1>(n),
+            std::get<2>(n).NumberOfDistinctiveNumbers,
+            std::get<2>(n).Ramdomness);
+    }
+    for (const auto& n : found.LargePage)
+    {
+        console.Out("[LargePage] PatchGuard context page base: %016I64x,"
+            " Size: 0x%08Ix, Randomness %3d:%3d,\n",
+            std::get<0>(n), std::get<1>(n),
+            std::get<2>(n).NumberOfDistinctiveNumbers,
+            std::get<2>(n).Ramdomness);
+    }
+    for (const auto& n : found.Timer)
+    {
+        console.Out("[Timer] PatchGuard context page base: %016I64x,"
+            " Size: 0x%08Ix, Randomness %3d:%3d, Timer: %016I64x\n",
+            std::get<0>(n), std::get<1>(n),
+            std::get<2>(n).NumberOfDistinctiveNumbers,
+            std::get<2>(n).Ramdomness, std::get<3>(n));
+    }
+    for (const auto& n : found.Decrypted)
+    {
+        console.Out("[Decrypted] PatchGuard code or context at %016I64x,"
+            " Pattern: %s\n",
+            std::get<0>(n), patterns.GetName(std::get<1>(n)).c_str());
+    }
+    DisplaySummary(console, found.Statistics, pageTables);
+}
+
+} // End of namespace {unnamed}
+
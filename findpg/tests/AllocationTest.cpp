@@ -0,0 +1,237 @@
+//
+// This module implements a test that the scan loops make no heap allocations
+// for each candidate. Two synthetic targets differing only in the number of
+// candidate pages are scanned, and the numbers of allocations made by the
+// scans, counted by replacing the global operator new, must be the same.
+//
+
+// C/C++ standard headers
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "PageTableSnapshot.h"
+#include "PteFilter.h"
+#include "Scanner.h"
+#include "SyntheticTarget.h"
+#include "TestUtil.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+namespace {
+
+// Start of the region of candidate pages, inside NonPagedPool assumed without
+// symbols
+const ULONG64 CANDIDATE_BASE = 0xffffe00000200000;
+
+// Start of the region holding the big pool table and variables of the kernel,
+// which is not executable
+const ULONG64 DATA_BASE = 0xffffe00000000000;
+
+// The number of entries in the big pool table, which is the same for both
+// targets so that only the number of used entries differs
+const SIZE_T BIG_POOL_TABLE_SIZE = 0x1000;
+
+// Each big pool allocation spans this number of candidate pages
+const SIZE_T PAGES_PER_ALLOCATION = 4;
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+std::uint64_t CountScanAllocations(
+    __in SIZE_T NumberOfCandidatePages);
+
+void BuildTarget(
+    __inout SyntheticTarget& Target,
+    __in SIZE_T NumberOfCandidatePages);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+namespace {
+
+// The number of calls of the global operator new
+std::uint64_t g_NumberOfAllocations = 0;
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+// Count every allocation. Other forms of operator new call these by default.
+void* operator new(
+    __in std::size_t Size)
+{
+    ++g_NumberOfAllocations;
+    if (auto memory = std::malloc(Size ? Size : 1))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+
+void* operator new[](
+    __in std::size_t Size)
+{
+    return operator new(Size);
+}
+
+
+void operator delete(
+    __in void* Memory) noexcept
+{
+    std::free(Memory);
+}
+
+
+void operator delete[](
+    __in void* Memory) noexcept
+{
+    std::free(Memory);
+}
+
+
+void operator delete(
+    __in void* Memory,
+    __in std::size_t) noexcept
+{
+    std::free(Memory);
+}
+
+
+void operator delete[](
+    __in void* Memory,
+    __in std::size_t) noexcept
+{
+    std::free(Memory);
+}
+
+
+int main()
+{
+    // Allocations made for a scan are the same regardless of the number of
+    // candidates, once per phase, table or stage
+    const auto fewer = CountScanAllocations(32);
+    const auto more = CountScanAllocations(256);
+    TEST_CHECK_EQUAL(fewer, more);
+    return GetTestResult("AllocationTest");
+}
+
+
+namespace {
+
+// Scans a target and returns the number of allocations made by the scan
+std::uint64_t CountScanAllocations(
+    __in SIZE_T NumberOfCandidatePages)
+{
+    SyntheticTarget target;
+    BuildTarget(target, NumberOfCandidatePages);
+    PageTableSnapshot pageTables;
+    ScanOptions options = {};
+    Scanner scanner(target, pageTables, options);
+
+    const auto before = g_NumberOfAllocations;
+    const auto result = scanner.Scan();
+    const auto numberOfAllocations = g_NumberOfAllocations - before;
+
+    // Both phases ran to the end, examined every candidate and found nothing
+    TEST_CHECK(result.Statistics[1].Error.empty());
+    TEST_CHECK(result.Statistics[2].Error.empty());
+    TEST_CHECK_EQUAL(BIG_POOL_TABLE_SIZE,
+        result.Statistics[1].NumberOfUnitsDone);
+    TEST_CHECK(result.Statistics[2].NumberOfUnitsDone != 0);
+    TEST_CHECK_EQUAL(0, result.Statistics[1].NumberOfReadFailures);
+    TEST_CHECK_EQUAL(0, result.Statistics[2].NumberOfReadFailures);
+    TEST_CHECK(result.BigPagePool.empty());
+    TEST_CHECK(result.Independent.empty());
+    return numberOfAllocations;
+}
+
+
+// Builds candidate pages and the big pool table describing them. Candidate
+// pages are RWX and alternate between zero-filled pages, rejected for too many
+// 0x00 bytes, and pages of letters, rejected for too few distinct bytes, so
+// that each of them goes through the content stages.
+void BuildTarget(
+    __inout SyntheticTarget& Target,
+    __in SIZE_T NumberOfCandidatePages)
+{
+    for (SIZE_T i = 0; i < NumberOfCandidatePages; ++i)
+    {
+        const auto page = Target.MapPage(CANDIDATE_BASE + (i << PTI_SHIFT),
+            PTE_VALID | PTE_WRITE);
+        if (i % 2)
+        {
+            for (SIZE_T j = 0; j < 0x1000; ++j)
+            {
+                page[j] = static_cast<std::uint8_t>('A' + j % 26);
+            }
+        }
+    }
+
+    // Variables of the kernel followed by the big pool table. Entries not
+    // describing candidates are free.
+    std::vector<std::uint8_t> data(0x1000
+        + BIG_POOL_TABLE_SIZE * sizeof(PoolTrackerBigPagesV1::ENTRY));
+    const ULONG64 variables[] = { DATA_BASE + 0x1000, BIG_POOL_TABLE_SIZE, };
+    memcpy(data.data(), variables, sizeof(variables));
+    auto entries = reinterpret_cast<PoolTrackerBigPagesV1::ENTRY*>(
+        data.data() + 0x1000);
+    for (SIZE_T i = 0; i < BIG_POOL_TABLE_SIZE; ++i)
+    {
+        entries[i].Va = 1;
+        if (i < NumberOfCandidatePages / PAGES_PER_ALLOCATION)
+        {
+            entries[i].Va = CANDIDATE_BASE
+                + ((i * PAGES_PER_ALLOCATION) << PTI_SHIFT);
+            entries[i].Key = 0x6c6f6f50;    // Pool
+            entries[i].NumberOfBytes = PAGES_PER_ALLOCATION * 0x1000;
+        }
+    }
+    Target.MapBytes(DATA_BASE, data.data(), data.size(),
+        PTE_VALID | PTE_WRITE | PTE_NO_EXECUTE);
+    Target.AddSymbol("nt!PoolBigPageTable", DATA_BASE);
+    Target.AddSymbol("nt!PoolBigPageTableSize", DATA_BASE + sizeof(ULONG64));
+}
+
+} // End of namespace {unnamed}
+
@@ -0,0 +1,208 @@
+//
+// This module implements tests of walking big pool tables in each layout of
+// nt!_POOL_TRACKER_BIG_PAGES selected by the size of the type.
+//
+
+// C/C++ standard headers
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "PageTableSnapshot.h"
+#include "PoolTrackerBigPages.h"
+#include "PteFilter.h"
+#include "Scanner.h"
+#include "SyntheticTarget.h"
+#include "TestUtil.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+namespace {
+
+// Start of the region of pool allocations, inside NonPagedPool assumed
+// without symbols
+const ULONG64 POOL_BASE = 0xffffe00000200000;
+
+// Start of the region holding the big pool table and variables of the kernel
+const ULONG64 DATA_BASE = 0xffffe00000000000;
+
+const SIZE_T BIG_POOL_TABLE_SIZE = 16;
+const SIZE_T ALLOCATION_SIZE = 0x4000;
+const ULONG POOL_TAG = 0x74536750;  // PgSt
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+template <typename Layout>
+ScanResult ScanBigPageTable(
+    __in ULONG TypeSize,
+    __in const typename Layout::ENTRY& FillerEntry);
+
+template <typename Layout>
+void TestLayout(
+    __in ULONG TypeSize,
+    __in const typename Layout::ENTRY& FillerEntry);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+int main()
+{
+    // Fields other than Va, Key and NumberOfBytes of entries are filled so
+    // that reading an entry in a wrong layout takes them as sizes
+    PoolTrackerBigPagesV1::ENTRY v1 = {};
+    v1.PoolType = 0x200;
+    PoolTrackerBigPagesV2::ENTRY v2 = {};
+    v2.Pattern = 0x42;
+    v2.PoolType = 0x200;
+    v2.ProcessBilled = 0xffffe00000003000;
+
+    // The oldest layout is assumed without type information
+    TestLayout<PoolTrackerBigPagesV1>(0, v1);
+    TestLayout<PoolTrackerBigPagesV1>(PoolTrackerBigPagesV1::EntrySize, v1);
+    TestLayout<PoolTrackerBigPagesV2>(PoolTrackerBigPagesV2::EntrySize, v2);
+
+    // Entries of the newer layout read with the size of the older one are
+    // misaligned from the second entry, and the allocation is missed
+    const auto misread = ScanBigPageTable<PoolTrackerBigPagesV2>(
+        PoolTrackerBigPagesV1::EntrySize, v2);
+    TEST_CHECK(misread.Statistics[1].Error.empty());
+    TEST_CHECK_EQUAL(BIG_POOL_TABLE_SIZE,
+        misread.Statistics[1].NumberOfUnitsDone);
+    for (const auto& found : misread.BigPagePool)
+    {
+        TEST_CHECK(std::get<0>(found).Va != POOL_BASE + ALLOCATION_SIZE);
+    }
+
+    // A table in an unknown layout fails only Phase 1
+    const auto result = ScanBigPageTable<PoolTrackerBigPagesV2>(0x28, v2);
+    TEST_CHECK(result.BigPagePool.empty());
+    TEST_CHECK(!result.Statistics[1].Error.empty());
+    TEST_CHECK(result.Statistics[2].Error.empty());
+    return GetTestResult("BigPoolLayoutTest");
+}
+
+
+namespace {
+
+// Scans a target with a big pool table of the layout. The first allocation
+// in the table is zero-filled, the second one has random contents, and the
+// rest of entries are free. The second entry is found only when entries are
+// read with the right size. TypeSize is the size of the type given by
+// symbols, or zero when it is not available.
+template <typename Layout>
+ScanResult ScanBigPageTable(
+    __in ULONG TypeSize,
+    __in const typename Layout::ENTRY& FillerEntry)
+{
+    SyntheticTarget target;
+    std::uint32_t seed = 1;
+    for (SIZE_T offset = 0; offset < ALLOCATION_SIZE; offset += 0x1000)
+    {
+        target.MapPage(POOL_BASE + offset, PTE_VALID | PTE_WRITE);
+        const auto page = target.MapPage(POOL_BASE + ALLOCATION_SIZE + offset,
+            PTE_VALID | PTE_WRITE);
+        for (SIZE_T i = 0; i < 0x1000; ++i)
+        {
+            // Neither 0x00 nor 0xff
+            seed = seed * 1103515245 + 12345;
+            page[i] = static_cast<std::uint8_t>(1 + (seed >> 16) % 254);
+        }
+    }
+
+    std::vector<std::uint8_t> data(0x1000
+        + BIG_POOL_TABLE_SIZE * sizeof(typename Layout::ENTRY));
+    const ULONG64 variables[] = { DATA_BASE + 0x1000, BIG_POOL_TABLE_SIZE, };
+    memcpy(data.data(), variables, sizeof(variables));
+    auto entries = reinterpret_cast<typename Layout::ENTRY*>(
+        data.data() + 0x1000);
+    for (SIZE_T i = 0; i < BIG_POOL_TABLE_SIZE; ++i)
+    {
+        entries[i] = FillerEntry;
+        entries[i].Va = 1;
+        if (i < 2)
+        {
+            entries[i].Va = POOL_BASE + i * ALLOCATION_SIZE;
+            entries[i].Key = POOL_TAG;
+            entries[i].NumberOfBytes = ALLOCATION_SIZE;
+        }
+    }
+    target.MapBytes(DATA_BASE, data.data(), data.size(),
+        PTE_VALID | PTE_WRITE | PTE_NO_EXECUTE);
+    target.AddSymbol("nt!PoolBigPageTable", DATA_BASE);
+    target.AddSymbol("nt!PoolBigPageTableSize", DATA_BASE + sizeof(ULONG64));
+    if (TypeSize)
+    {
+        target.AddTypeSize("nt!_POOL_TRACKER_BIG_PAGES", TypeSize);
+    }
+
+    PageTableSnapshot pageTables;
+    ScanOptions options = {};
+    Scanner scanner(target, pageTables, options);
+    return scanner.Scan();
+}
+
+
+// Checks that only the allocation with random contents is found with the
+// address, tag and size in its entry
+template <typename Layout>
+void TestLayout(
+    __in ULONG TypeSize,
+    __in const typename Layout::ENTRY& FillerEntry)
+{
+    const auto result = ScanBigPageTable<Layout>(TypeSize, FillerEntry);
+    TEST_CHECK(result.Statistics[1].Error.empty());
+    TEST_CHECK_EQUAL(BIG_POOL_TABLE_SIZE,
+        result.Statistics[1].NumberOfUnitsDone);
+    TEST_CHECK_EQUAL(1, result.BigPagePool.size());
+    if (result.BigPagePool.size() != 1)
+    {
+        return;
+    }
+    const auto& entry = std::get<0>(result.BigPagePool[0]);
+    TEST_CHECK_EQUAL(POOL_BASE + ALLOCATION_SIZE, entry.Va);
+    TEST_CHECK_EQUAL(POOL_TAG, entry.Key);
+    TEST_CHECK_EQUAL(ALLOCATION_SIZE, entry.Size);
+}
+
+} // End of namespace {unnamed}
+
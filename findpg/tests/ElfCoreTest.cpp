@@ -0,0 +1,259 @@
+//
+// This module implements tests of ElfCoreProvider against ELF core files in
+// the format written by QEMU dump-guest-memory, built from synthetic targets
+// in both 4-level and 5-level paging.
+//
+
+// C/C++ standard headers
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "ElfCoreProvider.h"
+#include "PageTableSnapshot.h"
+#include "PagingMode.h"
+#include "Scanner.h"
+#include "SyntheticTarget.h"
+#include "TestUtil.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+namespace {
+
+const char TEST_FILE_PATH[] = "ElfCoreTest.elf";
+
+// Sizes of ELF structures and offsets in the QEMU CPU state
+const SIZE_T ELF_HEADER_SIZE = 64;
+const SIZE_T PROGRAM_HEADER_SIZE = 56;
+const SIZE_T NOTE_HEADER_SIZE = 12;
+const SIZE_T QEMU_CPU_STATE_SIZE = 0x1b0;
+const SIZE_T QEMU_CPU_STATE_RIP_OFFSET = 136;
+const SIZE_T QEMU_CPU_STATE_CR3_OFFSET = 416;
+const SIZE_T QEMU_CPU_STATE_CR4_OFFSET = 424;
+
+const ULONG64 CR4_LA57 = 1ull << 12;
+
+// The size of an independent region mapped in the guest
+const ULONG64 REGION_SIZE = 0x4000;
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+template <typename Mode>
+void TestElfCore(
+    __in ULONG64 SelfMapIndex);
+
+std::vector<std::uint8_t> BuildElfCore(
+    __in const SyntheticTarget& Target,
+    __in bool IsFiveLevelPaging);
+
+void AppendQemuNote(
+    __inout std::vector<std::uint8_t>& Notes,
+    __in ULONG64 Rip,
+    __in ULONG64 Cr3,
+    __in ULONG64 Cr4);
+
+template <typename T>
+void Put(
+    __inout std::vector<std::uint8_t>& Bytes,
+    __in SIZE_T Offset,
+    __in T Value);
+
+bool WriteTestFile(
+    __in const std::vector<std::uint8_t>& Bytes);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+int main()
+{
+    TestElfCore<FourLevelPaging>(CLASSIC_SELF_MAP_INDEX);
+    TestElfCore<FourLevelPaging>(0x1a3);
+    TestElfCore<FiveLevelPaging>(0x1a3);
+    std::remove(TEST_FILE_PATH);
+    return GetTestResult("ElfCoreTest");
+}
+
+
+namespace {
+
+// Scans an ELF core of a guest in the mode with an independent region at the
+// start of NonPagedPool. The guest has no symbols, so the region is found only
+// when CR3, the paging mode and the self-map are all taken from the file.
+template <typename Mode>
+void TestElfCore(
+    __in ULONG64 SelfMapIndex)
+{
+    SyntheticTarget target(Mode::NumberOfLevels, SelfMapIndex);
+    const auto regionBase =
+        PagingLayout<Mode>::GetDefaultNonPagedPoolStart() + 0x200000;
+    target.MapIndependentRegion(regionBase, REGION_SIZE);
+    if (!WriteTestFile(BuildElfCore(target,
+        Mode::NumberOfLevels == FiveLevelPaging::NumberOfLevels)))
+    {
+        TEST_CHECK(!"The test file could not be created.");
+        return;
+    }
+
+    ElfCoreProvider provider(target, TEST_FILE_PATH, 0);
+    provider.SetQuiet(true);
+    TEST_CHECK_EQUAL(1, provider.GetNumberOfSegments());
+    TEST_CHECK_EQUAL(target.GetDirectoryTableBase(),
+        provider.GetDirectoryTableBase());
+    ULONG numberOfLevels = 0;
+    ULONG64 selfMapIndex = 0;
+    TEST_CHECK(provider.GetPagingMode(numberOfLevels, selfMapIndex));
+    TEST_CHECK_EQUAL(Mode::NumberOfLevels, numberOfLevels);
+    TEST_CHECK_EQUAL(SelfMapIndex, selfMapIndex);
+
+    PageTableSnapshot pageTables;
+    ScanOptions options = {};
+    Scanner scanner(provider, pageTables, options);
+    const auto result = scanner.Scan();
+    TEST_CHECK(result.Statistics[2].Error.empty());
+    TEST_CHECK_EQUAL(1, result.Independent.size());
+    if (result.Independent.size() != 1)
+    {
+        return;
+    }
+    TEST_CHECK_EQUAL(regionBase, std::get<0>(result.Independent[0]));
+    TEST_CHECK_EQUAL(REGION_SIZE, std::get<1>(result.Independent[0]));
+}
+
+
+// Builds an ELF core with a PT_NOTE segment holding the QEMU CPU state of two
+// vCPUs and a PT_LOAD segment holding all physical memory of the target. The
+// first vCPU runs in user mode with a CR3 mapping nothing, so that CR3 has to
+// be taken from the second one running in kernel mode.
+std::vector<std::uint8_t> BuildElfCore(
+    __in const SyntheticTarget& Target,
+    __in bool IsFiveLevelPaging)
+{
+    const auto cr4 = (IsFiveLevelPaging) ? CR4_LA57 : 0;
+    std::vector<std::uint8_t> notes;
+    AppendQemuNote(notes, 0x00007ff700001000, 0x7fff000, cr4);
+    AppendQemuNote(notes, 0xfffff80000001000, Target.GetDirectoryTableBase(),
+        cr4);
+    const auto memory = Target.GetPhysicalMemory();
+
+    const SIZE_T notesOffset = ELF_HEADER_SIZE + PROGRAM_HEADER_SIZE * 2;
+    const SIZE_T memoryOffset = (notesOffset + notes.size() + 0xfff) & ~0xfff;
+    std::vector<std::uint8_t> core(memoryOffset + memory.size());
+    const std::uint8_t identity[] = { 0x7f, 'E', 'L', 'F', 2, 1, 1, };
+    memcpy(core.data(), identity, sizeof(identity));
+    Put<USHORT>(core, 16, 4);                       // ET_CORE
+    Put<USHORT>(core, 18, 62);                      // EM_X86_64
+    Put<ULONG>(core, 20, 1);
+    Put<ULONG64>(core, 32, ELF_HEADER_SIZE);        // Program headers
+    Put<USHORT>(core, 52, ELF_HEADER_SIZE);
+    Put<USHORT>(core, 54, PROGRAM_HEADER_SIZE);
+    Put<USHORT>(core, 56, 2);
+
+    auto programHeader = ELF_HEADER_SIZE;
+    Put<ULONG>(core, programHeader, 4);             // PT_NOTE
+    Put<ULONG64>(core, programHeader + 8, notesOffset);
+    Put<ULONG64>(core, programHeader + 32, notes.size());
+    Put<ULONG64>(core, programHeader + 40, notes.size());
+
+    programHeader += PROGRAM_HEADER_SIZE;
+    Put<ULONG>(core, programHeader, 1);             // PT_LOAD
+    Put<ULONG>(core, programHeader + 4, 7);         // RWX
+    Put<ULONG64>(core, programHeader + 8, memoryOffset);
+    Put<ULONG64>(core, programHeader + 24, 0);      // Physical address
+    Put<ULONG64>(core, programHeader + 32, memory.size());
+    Put<ULONG64>(core, programHeader + 40, memory.size());
+    Put<ULONG64>(core, programHeader + 48, 0x1000);
+
+    memcpy(core.data() + notesOffset, notes.data(), notes.size());
+    memcpy(core.data() + memoryOffset, memory.data(), memory.size());
+    return core;
+}
+
+
+// Appends a note named "QEMU" with the CPU state of a vCPU
+void AppendQemuNote(
+    __inout std::vector<std::uint8_t>& Notes,
+    __in ULONG64 Rip,
+    __in ULONG64 Cr3,
+    __in ULONG64 Cr4)
+{
+    const auto note = Notes.size();
+    const auto description = note + NOTE_HEADER_SIZE + 8;
+    Notes.resize(description + QEMU_CPU_STATE_SIZE);
+    Put<ULONG>(Notes, note, 5);
+    Put<ULONG>(Notes, note + 4, QEMU_CPU_STATE_SIZE);
+    Put<ULONG>(Notes, note + 8, 0);
+    memcpy(Notes.data() + note + NOTE_HEADER_SIZE, "QEMU", 5);
+    Put<ULONG>(Notes, description, 1);              // Version
+    Put<ULONG>(Notes, description + 4, QEMU_CPU_STATE_SIZE);
+    Put<ULONG64>(Notes, description + QEMU_CPU_STATE_RIP_OFFSET, Rip);
+    Put<ULONG64>(Notes, description + QEMU_CPU_STATE_CR3_OFFSET, Cr3);
+    Put<ULONG64>(Notes, description + QEMU_CPU_STATE_CR4_OFFSET, Cr4);
+}
+
+
+template <typename T>
+void Put(
+    __inout std::vector<std::uint8_t>& Bytes,
+    __in SIZE_T Offset,
+    __in T Value)
+{
+    memcpy(Bytes.data() + Offset, &Value, sizeof(Value));
+}
+
+
+bool WriteTestFile(
+    __in const std::vector<std::uint8_t>& Bytes)
+{
+    const auto file = std::fopen(TEST_FILE_PATH, "wb");
+    if (!file)
+    {
+        return false;
+    }
+    const auto isWritten = std::fwrite(Bytes.data(), 1, Bytes.size(), file)
+        == Bytes.size();
+    return std::fclose(file) == 0 && isWritten;
+}
+
+} // End of namespace {unnamed}
+
@@ -0,0 +1,169 @@
+//
+// This module implements tests of reading a file larger than the maximum
+// number of bytes mapped at once through windows of MappedFile.
+//
+
+// C/C++ standard headers
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "MappedFile.h"
+#include "TestUtil.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+namespace {
+
+const char TEST_FILE_PATH[] = "MappedFileTest.bin";
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+bool CreateTestFile(
+    __in ULONG64 Size);
+
+ULONG64 ReadValue(
+    __inout MappedFile& File,
+    __in ULONG64 Offset);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+int main()
+{
+    // Three and a half windows, while only two windows may be mapped. Each
+    // 8-byte value of the file is its own offset.
+    const auto windowSize = MappedFile::GetWindowSize();
+    const auto fileSize = windowSize * 3 + windowSize / 2;
+    if (!CreateTestFile(fileSize))
+    {
+        TEST_CHECK(!"The test file could not be created.");
+        return GetTestResult("MappedFileTest");
+    }
+
+    {
+        MappedFile file(TEST_FILE_PATH, false, windowSize * 2);
+        TEST_CHECK_EQUAL(fileSize, file.GetSize());
+        TEST_CHECK_EQUAL(windowSize * 2, file.GetMaximumMappedBytes());
+
+        // A read across windows maps both of them
+        ULONG64 values[2] = {};
+        TEST_CHECK(file.Read(windowSize - 8, values, sizeof(values)));
+        TEST_CHECK_EQUAL(windowSize - 8, values[0]);
+        TEST_CHECK_EQUAL(windowSize, values[1]);
+        TEST_CHECK_EQUAL(2, file.GetNumberOfMaps());
+
+        // The third window evicts the first one, the least recently used
+        TEST_CHECK_EQUAL(windowSize * 2 + 0x1238,
+            ReadValue(file, windowSize * 2 + 0x1238));
+        TEST_CHECK_EQUAL(3, file.GetNumberOfMaps());
+        TEST_CHECK_EQUAL(2, file.GetNumberOfWindows());
+
+        // The second window is still mapped
+        TEST_CHECK_EQUAL(windowSize + 0x5000,
+            ReadValue(file, windowSize + 0x5000));
+        TEST_CHECK_EQUAL(3, file.GetNumberOfMaps());
+
+        // The first window is mapped again with the same contents, evicting
+        // the third one
+        TEST_CHECK_EQUAL(0x10, ReadValue(file, 0x10));
+        TEST_CHECK_EQUAL(4, file.GetNumberOfMaps());
+        TEST_CHECK_EQUAL(windowSize * 2 + 8,
+            ReadValue(file, windowSize * 2 + 8));
+        TEST_CHECK_EQUAL(5, file.GetNumberOfMaps());
+        TEST_CHECK_EQUAL(2, file.GetNumberOfWindows());
+
+        // The last window is shorter than the others
+        ULONG64 available = 0;
+        TEST_CHECK(file.Map(fileSize - 0x100, available) != nullptr);
+        TEST_CHECK_EQUAL(0x100, available);
+        TEST_CHECK_EQUAL(fileSize - 8, ReadValue(file, fileSize - 8));
+
+        // Nothing beyond the end of the file is read
+        TEST_CHECK(!file.Map(fileSize, available));
+        TEST_CHECK_EQUAL(0, available);
+        TEST_CHECK(!file.Read(fileSize - 8, values, sizeof(values)));
+    }
+    std::remove(TEST_FILE_PATH);
+    return GetTestResult("MappedFileTest");
+}
+
+
+namespace {
+
+// Creates the test file where each 8-byte value is its offset
+bool CreateTestFile(
+    __in ULONG64 Size)
+{
+    const auto file = std::fopen(TEST_FILE_PATH, "wb");
+    if (!file)
+    {
+        return false;
+    }
+    std::vector<ULONG64> chunk(0x100000 / sizeof(ULONG64));
+    auto isWritten = true;
+    for (ULONG64 offset = 0; offset < Size && isWritten;
+        offset += chunk.size() * sizeof(ULONG64))
+    {
+        for (SIZE_T i = 0; i < chunk.size(); ++i)
+        {
+            chunk[i] = offset + i * sizeof(ULONG64);
+        }
+        isWritten = std::fwrite(chunk.data(), sizeof(ULONG64), chunk.size(),
+            file) == chunk.size();
+    }
+    return std::fclose(file) == 0 && isWritten;
+}
+
+
+// Reads the 8-byte value at Offset, or returns all bits set on failure
+ULONG64 ReadValue(
+    __inout MappedFile& File,
+    __in ULONG64 Offset)
+{
+    ULONG64 value = 0;
+    return (File.Read(Offset, &value, sizeof(value))) ? value : ~0ull;
+}
+
+} // End of namespace {unnamed}
+
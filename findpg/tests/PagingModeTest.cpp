@@ -0,0 +1,280 @@
+//
+// This module implements tests of addresses of page tables calculated by
+// PagingLayout, detection of the paging mode from nt!MmPteBase, and walks of
+// synthetic page tables in both 4-level and 5-level paging.
+//
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "PageTableSnapshot.h"
+#include "PagingMode.h"
+#include "PteFilter.h"
+#include "Scanner.h"
+#include "SyntheticTarget.h"
+#include "TestUtil.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+namespace {
+
+// The size of an independent region mapped in synthetic targets
+const ULONG64 REGION_SIZE = 0x4000;
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// Expected bases of tables of each level, from PTEs, for a self-map index
+struct LayoutCase
+{
+    ULONG64 SelfMapIndex;
+    ULONG64 TableBases[5];
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+template <typename Mode, SIZE_T NumberOfCases>
+void TestLayouts(
+    const LayoutCase (&Cases)[NumberOfCases]);
+
+template <typename Mode>
+void TestEntries();
+
+void TestDetection();
+
+void TestDefaultNonPagedPoolStart();
+
+template <typename Mode>
+void TestScan(
+    __in ULONG64 SelfMapIndex,
+    __in bool HasPteBaseSymbol);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+namespace {
+
+const LayoutCase FOUR_LEVEL_CASES[] =
+{
+    // Windows 8.1 and earlier
+    { 0x1ed, { 0xfffff68000000000, 0xfffff6fb40000000, 0xfffff6fb7da00000,
+               0xfffff6fb7dbed000, } },
+    // The lowest and highest indexes in the kernel half
+    { 0x100, { 0xffff800000000000, 0xffff804000000000, 0xffff804020000000,
+               0xffff804020100000, } },
+    { 0x1ff, { 0xffffff8000000000, 0xffffffffc0000000, 0xffffffffffe00000,
+               0xfffffffffffff000, } },
+};
+
+const LayoutCase FIVE_LEVEL_CASES[] =
+{
+    { 0x1ed, { 0xffed000000000000, 0xffedf68000000000, 0xffedf6fb40000000,
+               0xffedf6fb7da00000, 0xffedf6fb7dbed000, } },
+    { 0x100, { 0xff00000000000000, 0xff00800000000000, 0xff00804000000000,
+               0xff00804020000000, 0xff00804020100000, } },
+    // Bits 48-55 of the base are all set as they are with 4-level paging
+    { 0x1ff, { 0xffff000000000000, 0xffffff8000000000, 0xffffffffc0000000,
+               0xffffffffffe00000, 0xfffffffffffff000, } },
+};
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+int main()
+{
+    TestLayouts<FourLevelPaging>(FOUR_LEVEL_CASES);
+    TestLayouts<FiveLevelPaging>(FIVE_LEVEL_CASES);
+    TestEntries<FourLevelPaging>();
+    TestEntries<FiveLevelPaging>();
+    TestDetection();
+    TestDefaultNonPagedPoolStart();
+
+    // The classic and a randomized self-map in each mode, found either
+    // through nt!MmPteBase or by the provider
+    const ULONG64 selfMapIndexes[] = { CLASSIC_SELF_MAP_INDEX, 0x1a3, };
+    for (const auto selfMapIndex : selfMapIndexes)
+    {
+        TestScan<FourLevelPaging>(selfMapIndex, true);
+        TestScan<FourLevelPaging>(selfMapIndex, false);
+        TestScan<FiveLevelPaging>(selfMapIndex, true);
+        TestScan<FiveLevelPaging>(selfMapIndex, false);
+    }
+    return GetTestResult("PagingModeTest");
+}
+
+
+namespace {
+
+// Checks bases of all levels and that the self-map entry references the
+// top-level table itself
+template <typename Mode, SIZE_T NumberOfCases>
+void TestLayouts(
+    const LayoutCase (&Cases)[NumberOfCases])
+{
+    for (const auto& testCase : Cases)
+    {
+        const PagingLayout<Mode> layout(testCase.SelfMapIndex);
+        for (ULONG level = 0; level < Mode::NumberOfLevels; ++level)
+        {
+            TEST_CHECK_EQUAL(testCase.TableBases[level],
+                layout.GetTable(level, 0));
+        }
+
+        const auto topLevel = Mode::NumberOfLevels - 1;
+        const auto topTable = testCase.TableBases[topLevel];
+        TEST_CHECK_EQUAL(topTable, layout.GetTable(topLevel - 1,
+            testCase.SelfMapIndex));
+        TEST_CHECK_EQUAL(topTable + testCase.SelfMapIndex * 8,
+            layout.GetEntry(topLevel, topTable));
+    }
+}
+
+
+// Checks that an entry of each level is in the table referenced by the entry
+// of the level above, and that the entry maps the address
+template <typename Mode>
+void TestEntries()
+{
+    const PagingLayout<Mode> layout(CLASSIC_SELF_MAP_INDEX);
+    const auto address = PagingLayout<Mode>::SignExtend(
+        (1ull << (Mode::VirtualAddressBits - 1)) + 0x12345678abc);
+    for (ULONG level = 0; level + 1 < Mode::NumberOfLevels; ++level)
+    {
+        const auto index = PagingLayout<Mode>::GetIndex(level + 1, address);
+        const auto entry = layout.GetEntry(level, address);
+        TEST_CHECK_EQUAL(layout.GetTable(level, index),
+            entry & ~static_cast<ULONG64>(0xfff));
+        TEST_CHECK_EQUAL(PagingLayout<Mode>::GetAddress(level + 1, index),
+            address & ~((1ull << (PTI_SHIFT + 9 * (level + 1))) - 1));
+    }
+
+    // The well-known PTE of the address on Windows 8.1 and earlier
+    if (Mode::NumberOfLevels == FourLevelPaging::NumberOfLevels)
+    {
+        TEST_CHECK_EQUAL(0xfffff6fc00000000,
+            layout.GetEntry(PteLevel, 0xfffff80000000000));
+    }
+}
+
+
+// Checks that each base of PTEs is recognized only by its own mode
+void TestDetection()
+{
+    for (const auto& testCase : FOUR_LEVEL_CASES)
+    {
+        const auto pteBase = testCase.TableBases[PteLevel];
+        TEST_CHECK_EQUAL(testCase.SelfMapIndex,
+            PagingLayout<FourLevelPaging>::FindSelfMapIndex(pteBase));
+        TEST_CHECK_EQUAL(0,
+            PagingLayout<FiveLevelPaging>::FindSelfMapIndex(pteBase));
+    }
+    for (const auto& testCase : FIVE_LEVEL_CASES)
+    {
+        const auto pteBase = testCase.TableBases[PteLevel];
+        TEST_CHECK_EQUAL(0,
+            PagingLayout<FourLevelPaging>::FindSelfMapIndex(pteBase));
+        TEST_CHECK_EQUAL(testCase.SelfMapIndex,
+            PagingLayout<FiveLevelPaging>::FindSelfMapIndex(pteBase));
+    }
+
+    // Neither a user address nor an address inside the PTE range is a base
+    const ULONG64 invalidBases[] =
+    {
+        0x00007f8000000000, 0xfffff68000001000, 0xfffff6fb40000000,
+        0xffedf68000000000, 0x0000000000000000,
+    };
+    for (const auto pteBase : invalidBases)
+    {
+        TEST_CHECK_EQUAL(0,
+            PagingLayout<FourLevelPaging>::FindSelfMapIndex(pteBase));
+        TEST_CHECK_EQUAL(0,
+            PagingLayout<FiveLevelPaging>::FindSelfMapIndex(pteBase));
+    }
+}
+
+
+void TestDefaultNonPagedPoolStart()
+{
+    TEST_CHECK_EQUAL(0xffffe00000000000,
+        PagingLayout<FourLevelPaging>::GetDefaultNonPagedPoolStart());
+    TEST_CHECK_EQUAL(0xffc0000000000000,
+        PagingLayout<FiveLevelPaging>::GetDefaultNonPagedPoolStart());
+}
+
+
+// Scans a target of the mode with an independent region at the start of
+// NonPagedPool, which is found only when page tables are walked in the mode
+// and the layout of the target
+template <typename Mode>
+void TestScan(
+    __in ULONG64 SelfMapIndex,
+    __in bool HasPteBaseSymbol)
+{
+    SyntheticTarget target(Mode::NumberOfLevels, SelfMapIndex);
+    const auto dataBase = PagingLayout<Mode>::GetDefaultNonPagedPoolStart();
+    const auto regionBase = dataBase + 0x200000;
+    if (HasPteBaseSymbol)
+    {
+        const auto pteBase =
+            PagingLayout<Mode>(SelfMapIndex).GetTable(PteLevel, 0);
+        target.MapBytes(dataBase, &pteBase, sizeof(pteBase),
+            PTE_VALID | PTE_WRITE | PTE_NO_EXECUTE);
+        target.AddSymbol("nt!MmPteBase", dataBase);
+    }
+    else
+    {
+        target.ReportPagingMode();
+    }
+
+    target.MapIndependentRegion(regionBase, REGION_SIZE);
+
+    PageTableSnapshot pageTables;
+    ScanOptions options = {};
+    Scanner scanner(target, pageTables, options);
+    const auto result = scanner.Scan();
+    TEST_CHECK(result.Statistics[2].Error.empty());
+    TEST_CHECK_EQUAL(1, result.Independent.size());
+    if (result.Independent.size() != 1)
+    {
+        return;
+    }
+    TEST_CHECK_EQUAL(regionBase, std::get<0>(result.Independent[0]));
+    TEST_CHECK_EQUAL(REGION_SIZE, std::get<1>(result.Independent[0]));
+}
+
+} // End of namespace {unnamed}
+
@@ -0,0 +1,83 @@
+//
+// This module implements tests of PfnBitmap including page frame numbers far
+// apart from each other.
+//
+
+// C/C++ standard headers
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "PfnBitmap.h"
+#include "TestUtil.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+int main()
+{
+    // Low memory, both sides of a chunk boundary, and the highest page frame
+    // numbers of 52-bit physical addresses, which a flat table of chunks
+    // cannot hold
+    const ULONG64 pfns[] =
+    {
+        0, 1, 63, 64, 0x7fff, 0x8000, 0x12345678, 0x8000000000,
+        (1ull << 40) - 1,
+    };
+    PfnBitmap bitmap;
+    for (const auto pfn : pfns)
+    {
+        TEST_CHECK(!bitmap.TestAndSet(pfn));
+    }
+    for (const auto pfn : pfns)
+    {
+        TEST_CHECK(bitmap.TestAndSet(pfn));
+    }
+
+    // Neighbors of set bits are not affected
+    TEST_CHECK(!bitmap.TestAndSet(2));
+    TEST_CHECK(!bitmap.TestAndSet(0x7ffe));
+    TEST_CHECK(!bitmap.TestAndSet(0x8001));
+    TEST_CHECK(!bitmap.TestAndSet(0xfffffffffe));
+
+    // A cleared bit is set again without affecting its neighbors
+    bitmap.Clear(0x8000);
+    TEST_CHECK(!bitmap.TestAndSet(0x8000));
+    TEST_CHECK(bitmap.TestAndSet(0x8001));
+    return GetTestResult("PfnBitmapTest");
+}
+
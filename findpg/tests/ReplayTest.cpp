@@ -0,0 +1,149 @@
+//
+// This module implements tests of replaying a trace recorded from a scan of a
+// synthetic target with FindPgReplay().
+//
+
+// C/C++ standard headers
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "FindPgApi.h"
+#include "NegativeReadCache.h"
+#include "PageTableSnapshot.h"
+#include "PagingMode.h"
+#include "Scanner.h"
+#include "SyntheticTarget.h"
+#include "TestUtil.h"
+#include "TraceRecorder.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+namespace {
+
+const char TEST_FILE_PATH[] = "ReplayTest.trace";
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+void CALLBACK AppendOutput(
+    __in void* Context,
+    __in const char* Text);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+// Records a scan of a target with two independent regions and replays it
+// without the target. The replay has to make exactly the recorded requests
+// and return the same regions.
+int main()
+{
+    SyntheticTarget target;
+    const auto poolStart =
+        PagingLayout<FourLevelPaging>::GetDefaultNonPagedPoolStart();
+    target.MapIndependentRegion(poolStart + 0x200000, 0x4000);
+    target.MapIndependentRegion(poolStart + 0x400000, 0x5000);
+
+    ScanResult recorded;
+    {
+        TraceRecorder recorder(target, TEST_FILE_PATH);
+        NegativeReadCache provider(recorder);
+        PageTableSnapshot pageTables;
+        ScanOptions options = {};
+        Scanner scanner(provider, pageTables, options);
+        recorded = scanner.Scan();
+        TEST_CHECK(recorder.GetNumberOfRecords() != 0);
+    }
+    TEST_CHECK_EQUAL(2, recorded.Independent.size());
+
+    FINDPG_SCAN_OPTIONS options = {};
+    options.Size = sizeof(options);
+    std::string output;
+    FINDPG_REGION regions[4] = {};
+    ULONG numberOfRegions = 0;
+    TEST_CHECK(FindPgReplay(TEST_FILE_PATH, &options, AppendOutput, &output,
+        regions, _countof(regions), &numberOfRegions) == S_OK);
+    TEST_CHECK(output.find("\n0 requests were not found") !=
+        std::string::npos);
+    TEST_CHECK_EQUAL(recorded.Independent.size(), numberOfRegions);
+    for (ULONG i = 0; i < numberOfRegions &&
+        i < recorded.Independent.size(); ++i)
+    {
+        const auto& expected = recorded.Independent[i];
+        TEST_CHECK_EQUAL(FINDPG_REGION_INDEPENDENT, regions[i].Type);
+        TEST_CHECK_EQUAL(std::get<0>(expected), regions[i].Base);
+        TEST_CHECK_EQUAL(std::get<1>(expected), regions[i].Size);
+        TEST_CHECK_EQUAL(std::get<2>(expected).NumberOfDistinctiveNumbers,
+            regions[i].NumberOfDistinctiveNumbers);
+        TEST_CHECK_EQUAL(std::get<2>(expected).Ramdomness,
+            regions[i].Randomness);
+    }
+
+    // The same trace gives the same result every time
+    FINDPG_REGION replayed[4] = {};
+    TEST_CHECK(FindPgReplay(TEST_FILE_PATH, &options, nullptr, nullptr,
+        replayed, _countof(replayed), &numberOfRegions) == S_OK);
+    TEST_CHECK(memcmp(regions, replayed, sizeof(regions)) == 0);
+
+    // Too small a buffer
+    TEST_CHECK(FindPgReplay(TEST_FILE_PATH, &options, nullptr, nullptr,
+        replayed, 1, &numberOfRegions) == S_FALSE);
+    TEST_CHECK_EQUAL(2, numberOfRegions);
+
+    std::remove(TEST_FILE_PATH);
+    TEST_CHECK(FindPgReplay(TEST_FILE_PATH, &options, nullptr, nullptr,
+        replayed, _countof(replayed), &numberOfRegions) == E_FAIL);
+    return GetTestResult("ReplayTest");
+}
+
+
+namespace {
+
+void CALLBACK AppendOutput(
+    __in void* Context,
+    __in const char* Text)
+{
+    *static_cast<std::string*>(Context) += Text;
+}
+
+} // End of namespace {unnamed}
+
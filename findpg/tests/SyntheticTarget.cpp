@@ -0,0 +1,318 @@
+//
+// This module implements a class responsible for providing tests with a
+// synthetic target whose memory and symbols are built by the tests.
+//
+
+// C/C++ standard headers
+#include <cstring>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "SyntheticTarget.h"
+#include "PteFilter.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+SyntheticTarget::SyntheticTarget(
+    __in ULONG NumberOfLevels,
+    __in ULONG64 SelfMapIndex)
+    : m_NextPfn(1)
+    , m_NumberOfLevels(NumberOfLevels)
+    , m_SelfMapIndex(SelfMapIndex)
+    , m_TopLevelPfn(0)
+    , m_ReportsPagingMode(false)
+{
+    m_TopLevelPfn = AllocatePage();
+    reinterpret_cast<ULONG64*>(GetPage(m_TopLevelPfn))[SelfMapIndex] =
+        (m_TopLevelPfn << PTI_SHIFT) | PTE_VALID | PTE_WRITE | PTE_NO_EXECUTE;
+}
+
+
+void SyntheticTarget::ReportPagingMode()
+{
+    m_ReportsPagingMode = true;
+}
+
+
+std::uint8_t* SyntheticTarget::MapPage(
+    __in ULONG64 Va,
+    __in ULONG64 Flags)
+{
+    const auto pfn = AllocatePage();
+    Map(Va, pfn, Flags);
+    return GetPage(pfn);
+}
+
+
+void SyntheticTarget::MapBytes(
+    __in ULONG64 Va,
+    __in const void* Data,
+    __in SIZE_T Size,
+    __in ULONG64 Flags)
+{
+    for (SIZE_T offset = 0; offset < Size; offset += 0x1000)
+    {
+        const auto bytes = (Size - offset < 0x1000) ? Size - offset : 0x1000;
+        memcpy(MapPage(Va + offset, Flags),
+            static_cast<const std::uint8_t*>(Data) + offset, bytes);
+    }
+}
+
+
+void SyntheticTarget::MapIndependentRegion(
+    __in ULONG64 Va,
+    __in ULONG64 Size)
+{
+    // Neither 0x00 nor 0xff, which are counted as distinctive bytes
+    std::uint32_t seed = 1;
+    for (ULONG64 offset = 0; offset < Size; offset += 0x1000)
+    {
+        const auto page = MapPage(Va + offset, PTE_VALID | PTE_WRITE);
+        for (SIZE_T i = 0; i < 0x1000; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            page[i] = static_cast<std::uint8_t>(1 + (seed >> 16) % 254);
+        }
+        if (!offset)
+        {
+            *reinterpret_cast<ULONG64*>(page) = Size;
+        }
+    }
+}
+
+
+void SyntheticTarget::AddSymbol(
+    __in const char* Symbol,
+    __in ULONG64 Offset)
+{
+    m_Symbols.emplace_back(Symbol, Offset);
+}
+
+
+void SyntheticTarget::AddTypeSize(
+    __in const char* Type,
+    __in ULONG Size)
+{
+    m_TypeSizes.emplace_back(Type, Size);
+}
+
+
+std::vector<std::uint8_t> SyntheticTarget::GetPhysicalMemory() const
+{
+    std::vector<std::uint8_t> memory(
+        static_cast<SIZE_T>(m_NextPfn << PTI_SHIFT));
+    for (const auto& page : m_Pages)
+    {
+        memcpy(memory.data() + (page.first << PTI_SHIFT),
+            page.second->data(), page.second->size());
+    }
+    return memory;
+}
+
+
+bool SyntheticTarget::GetPhysicalAddress(
+    __in ULONG64 Va,
+    __out ULONG64& PhysicalAddress)
+{
+    ULONG64 pfn = 0;
+    if (!Translate(Va, pfn))
+    {
+        PhysicalAddress = 0;
+        return false;
+    }
+    PhysicalAddress = (pfn << PTI_SHIFT) | (Va & 0xfff);
+    return true;
+}
+
+
+// Reads pages one by one until an unmapped page is reached
+bool SyntheticTarget::ReadVirtual(
+    __in ULONG64 Address,
+    __out void* Buffer,
+    __in ULONG Size,
+    __out_opt ULONG* ReadBytes)
+{
+    ULONG readBytes = 0;
+    while (readBytes < Size)
+    {
+        const auto va = Address + readBytes;
+        ULONG64 pfn = 0;
+        if (!Translate(va, pfn))
+        {
+            break;
+        }
+        const auto offset = static_cast<ULONG>(va & 0xfff);
+        auto bytes = Size - readBytes;
+        if (bytes > 0x1000 - offset)
+        {
+            bytes = 0x1000 - offset;
+        }
+        memcpy(static_cast<std::uint8_t*>(Buffer) + readBytes,
+            GetPage(pfn) + offset, bytes);
+        readBytes += bytes;
+    }
+    if (ReadBytes)
+    {
+        *ReadBytes = readBytes;
+    }
+    return readBytes != 0 || !Size;
+}
+
+
+bool SyntheticTarget::GetSymbolOffset(
+    __in const char* Symbol,
+    __out ULONG64& Offset)
+{
+    Offset = 0;
+    for (const auto& symbol : m_Symbols)
+    {
+        if (symbol.first == Symbol)
+        {
+            Offset = symbol.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool SyntheticTarget::GetTypeSize(
+    __in const char* Type,
+    __out ULONG& Size)
+{
+    Size = 0;
+    for (const auto& typeSize : m_TypeSizes)
+    {
+        if (typeSize.first == Type)
+        {
+            Size = typeSize.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool SyntheticTarget::GetPagingMode(
+    __out ULONG& NumberOfLevels,
+    __out ULONG64& SelfMapIndex)
+{
+    NumberOfLevels = (m_ReportsPagingMode) ? m_NumberOfLevels : 0;
+    SelfMapIndex = (m_ReportsPagingMode) ? m_SelfMapIndex : 0;
+    return m_ReportsPagingMode;
+}
+
+
+void SyntheticTarget::Write(
+    __in const char* Text)
+{
+    UNREFERENCED_PARAMETER(Text);
+}
+
+
+ULONG64 SyntheticTarget::AllocatePage()
+{
+    const auto pfn = m_NextPfn++;
+    m_Pages[pfn].reset(new Page());
+    return pfn;
+}
+
+
+std::uint8_t* SyntheticTarget::GetPage(
+    __in ULONG64 Pfn)
+{
+    const auto page = m_Pages.find(Pfn);
+    return (page != m_Pages.end()) ? page->second->data() : nullptr;
+}
+
+
+// Returns the entry of the table at Level mapping Va
+ULONG64* SyntheticTarget::GetEntry(
+    __in ULONG64 TablePfn,
+    __in ULONG Level,
+    __in ULONG64 Va)
+{
+    const auto index = (Va >> (PTI_SHIFT + 9 * Level)) & 0x1ff;
+    return reinterpret_cast<ULONG64*>(GetPage(TablePfn)) + index;
+}
+
+
+// Maps a 4KB page, creating tables on the way as needed
+void SyntheticTarget::Map(
+    __in ULONG64 Va,
+    __in ULONG64 Pfn,
+    __in ULONG64 Flags)
+{
+    auto tablePfn = m_TopLevelPfn;
+    for (ULONG level = m_NumberOfLevels - 1; level > PteLevel; --level)
+    {
+        auto entry = GetEntry(tablePfn, level, Va);
+        if (!(*entry & PTE_VALID))
+        {
+            *entry = (AllocatePage() << PTI_SHIFT) | PTE_VALID | PTE_WRITE;
+        }
+        tablePfn = (*entry >> PTI_SHIFT) & 0xffffffffffull;
+    }
+    *GetEntry(tablePfn, PteLevel, Va) = (Pfn << PTI_SHIFT) | Flags;
+}
+
+
+bool SyntheticTarget::Translate(
+    __in ULONG64 Va,
+    __out ULONG64& Pfn)
+{
+    auto tablePfn = m_TopLevelPfn;
+    for (ULONG level = m_NumberOfLevels - 1; ; --level)
+    {
+        const auto entry = *GetEntry(tablePfn, level, Va);
+        if (!(entry & PTE_VALID))
+        {
+            return false;
+        }
+        tablePfn = (entry >> PTI_SHIFT) & 0xffffffffffull;
+        if (level == PteLevel)
+        {
+            break;
+        }
+    }
+    Pfn = tablePfn;
+    return true;
+}
+
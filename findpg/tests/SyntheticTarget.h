@@ -0,0 +1,170 @@
+//
+// This module declears a class responsible for providing tests with a
+// synthetic target whose memory and symbols are built by the tests.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "PagingMode.h"
+#include "ScanProvider.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+// A target with 4-level or 5-level paging and the self-map at a given index,
+// whose page tables are built in physical pages kept in memory. Virtual
+// addresses are translated by walking the tables as the processor does, so
+// that addresses of page tables in the self-map are readable as well. Symbols
+// and sizes of types are only those added by a test. Nothing is allocated by
+// reading memory or resolving them.
+class SyntheticTarget : public ScanProvider
+{
+public:
+    explicit SyntheticTarget(
+        __in ULONG NumberOfLevels = FourLevelPaging::NumberOfLevels,
+        __in ULONG64 SelfMapIndex = CLASSIC_SELF_MAP_INDEX);
+
+    // Makes GetPagingMode() report the mode as a provider of a memory image
+    // knowing CR3 and CR4 does. Otherwise, it is only found through symbols.
+    void ReportPagingMode();
+
+    // Returns CR3 of the target
+    ULONG64 GetDirectoryTableBase() const
+    {
+        return m_TopLevelPfn << PTI_SHIFT;
+    }
+
+    // Returns contents of physical memory from address zero to the end of the
+    // last page allocated. Pages are allocated contiguously from PFN 1.
+    std::vector<std::uint8_t> GetPhysicalMemory() const;
+
+    // Translates Va into a physical address by walking the page tables
+    bool GetPhysicalAddress(
+        __in ULONG64 Va,
+        __out ULONG64& PhysicalAddress);
+
+    // Maps a new physical page at Va and returns its contents
+    std::uint8_t* MapPage(
+        __in ULONG64 Va,
+        __in ULONG64 Flags);
+
+    // Maps new physical pages at Va and copies Data into them
+    void MapBytes(
+        __in ULONG64 Va,
+        __in const void* Data,
+        __in SIZE_T Size,
+        __in ULONG64 Flags);
+
+    // Maps new RWX pages at Va holding an independent region, which starts
+    // with its size followed by random bytes
+    void MapIndependentRegion(
+        __in ULONG64 Va,
+        __in ULONG64 Size);
+
+    void AddSymbol(
+        __in const char* Symbol,
+        __in ULONG64 Offset);
+
+    void AddTypeSize(
+        __in const char* Type,
+        __in ULONG Size);
+
+    virtual bool ReadVirtual(
+        __in ULONG64 Address,
+        __out void* Buffer,
+        __in ULONG Size,
+        __out_opt ULONG* ReadBytes) override;
+
+    virtual bool GetSymbolOffset(
+        __in const char* Symbol,
+        __out ULONG64& Offset) override;
+
+    virtual bool GetTypeSize(
+        __in const char* Type,
+        __out ULONG& Size) override;
+
+    virtual bool GetPagingMode(
+        __out ULONG& NumberOfLevels,
+        __out ULONG64& SelfMapIndex) override;
+
+    virtual void Write(
+        __in const char* Text) override;
+
+private:
+    typedef std::array<std::uint8_t, 0x1000> Page;
+
+    ULONG64 AllocatePage();
+
+    std::uint8_t* GetPage(
+        __in ULONG64 Pfn);
+
+    ULONG64* GetEntry(
+        __in ULONG64 TablePfn,
+        __in ULONG Level,
+        __in ULONG64 Va);
+
+    void Map(
+        __in ULONG64 Va,
+        __in ULONG64 Pfn,
+        __in ULONG64 Flags);
+
+    bool Translate(
+        __in ULONG64 Va,
+        __out ULONG64& Pfn);
+
+    std::unordered_map<ULONG64, std::unique_ptr<Page>> m_Pages;
+    ULONG64 m_NextPfn;
+    ULONG m_NumberOfLevels;
+    ULONG64 m_SelfMapIndex;
+    ULONG64 m_TopLevelPfn;
+    bool m_ReportsPagingMode;
+    std::vector<std::pair<std::string, ULONG64>> m_Symbols;
+    std::vector<std::pair<std::string, ULONG>> m_TypeSizes;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
@@ -0,0 +1,104 @@
+//
+// This module implements a minimal harness shared by the tests of the scan
+// core. Each test is a standalone executable that returns a non-zero exit code
+// when any check fails so that it can be run by ctest.
+//
+#pragma once
+
+// C/C++ standard headers
+#include <cstdio>
+
+// Other external headers
+// Windows headers
+// Original headers
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+// Reports a failure with the location and counts it without stopping the test
+#define TEST_CHECK(Expression) \
+    TestCheck(!!(Expression), #Expression, __FILE__, __LINE__)
+
+// Compares two 64-bit values and reports both of them on a mismatch
+#define TEST_CHECK_EQUAL(Expected, Actual) \
+    TestCheckEqual((Expected), (Actual), #Actual, __FILE__, __LINE__)
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+// The number of failed checks in this test
+inline unsigned long& GetNumberOfFailures()
+{
+    static unsigned long numberOfFailures = 0;
+    return numberOfFailures;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+inline void TestCheck(
+    __in bool Succeeded,
+    __in const char* Expression,
+    __in const char* File,
+    __in int Line)
+{
+    if (!Succeeded)
+    {
+        std::printf("%s(%d): check failed: %s\n", File, Line, Expression);
+        ++GetNumberOfFailures();
+    }
+}
+
+
+inline void TestCheckEqual(
+    __in unsigned long long Expected,
+    __in unsigned long long Actual,
+    __in const char* Expression,
+    __in const char* File,
+    __in int Line)
+{
+    if (Expected != Actual)
+    {
+        std::printf("%s(%d): %s is %016llx, expected %016llx\n", File, Line,
+            Expression, Actual, Expected);
+        ++GetNumberOfFailures();
+    }
+}
+
+
+// Returns the exit code of the test
+inline int GetTestResult(
+    __in const char* Name)
+{
+    const auto numberOfFailures = GetNumberOfFailures();
+    std::printf("%s: %lu failure(s)\n", Name, numberOfFailures);
+    return numberOfFailures ? 1 : 0;
+}
+
@@ -0,0 +1,193 @@
+//
+// This module implements tests of watching a memory file of a running virtual
+// machine, which is changed between scans as a guest does.
+//
+
+// C/C++ standard headers
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Other external headers
+// Windows headers
+#include <Windows.h>
+
+// Original headers
+#include "NegativeReadCache.h"
+#include "PageTableSnapshot.h"
+#include "PagingMode.h"
+#include "RawMemoryProvider.h"
+#include "RegionWatcher.h"
+#include "Scanner.h"
+#include "SyntheticTarget.h"
+#include "TestUtil.h"
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// macro utilities
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// constants and macros
+//
+
+namespace {
+
+const char TEST_FILE_PATH[] = "WatchTest.mem";
+
+// The size of an independent region mapped in the guest
+const ULONG64 REGION_SIZE = 0x4000;
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// types
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// prototypes
+//
+
+namespace {
+
+void ScanAndUpdate(
+    __inout RawMemoryProvider& Memory,
+    __inout RegionWatcher& Watcher,
+    __out std::vector<RegionWatcher::Region>& Added,
+    __out std::vector<RegionWatcher::Region>& Removed);
+
+bool WriteTestFile(
+    __in ULONG64 Offset,
+    __in const void* Data,
+    __in SIZE_T Size);
+
+} // End of namespace {unnamed}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// variables
+//
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// implementations
+//
+
+// Scans a memory file of a guest with an independent region three times. The
+// first page of the region is cleared in the file after the first scan and
+// restored after the second one, while the file stays mapped.
+int main()
+{
+    SyntheticTarget target;
+    const auto regionBase =
+        PagingLayout<FourLevelPaging>::GetDefaultNonPagedPoolStart() + 0x200000;
+    target.MapIndependentRegion(regionBase, REGION_SIZE);
+    ULONG64 regionPa = 0;
+    TEST_CHECK(target.GetPhysicalAddress(regionBase, regionPa));
+    const auto memory = target.GetPhysicalMemory();
+    std::remove(TEST_FILE_PATH);
+    if (!WriteTestFile(0, memory.data(), memory.size()))
+    {
+        TEST_CHECK(!"The test file could not be created.");
+        return GetTestResult("WatchTest");
+    }
+
+    {
+        RawMemoryProvider provider(target, TEST_FILE_PATH,
+            target.GetDirectoryTableBase(), 0, 0);
+        provider.SetQuiet(true);
+        RegionWatcher watcher;
+        std::vector<RegionWatcher::Region> added, removed;
+
+        ScanAndUpdate(provider, watcher, added, removed);
+        TEST_CHECK_EQUAL(1, added.size());
+        TEST_CHECK_EQUAL(0, removed.size());
+        TEST_CHECK_EQUAL(1, watcher.GetNumberOfRegions());
+        if (added.size() == 1)
+        {
+            TEST_CHECK(std::string(added[0].Kind) == "Independent");
+            TEST_CHECK_EQUAL(regionBase, added[0].Base);
+            TEST_CHECK_EQUAL(REGION_SIZE, added[0].Size);
+        }
+
+        // The guest frees the region
+        const std::vector<std::uint8_t> zeros(0x1000);
+        TEST_CHECK(WriteTestFile(regionPa, zeros.data(), zeros.size()));
+        ScanAndUpdate(provider, watcher, added, removed);
+        TEST_CHECK_EQUAL(0, added.size());
+        TEST_CHECK_EQUAL(1, removed.size());
+        TEST_CHECK_EQUAL(0, watcher.GetNumberOfRegions());
+        if (removed.size() == 1)
+        {
+            TEST_CHECK_EQUAL(regionBase, removed[0].Base);
+        }
+
+        // The guest allocates the region again
+        TEST_CHECK(WriteTestFile(regionPa, memory.data() + regionPa, 0x1000));
+        ScanAndUpdate(provider, watcher, added, removed);
+        TEST_CHECK_EQUAL(1, added.size());
+        TEST_CHECK_EQUAL(0, removed.size());
+
+        // Nothing changes
+        ScanAndUpdate(provider, watcher, added, removed);
+        TEST_CHECK_EQUAL(0, added.size());
+        TEST_CHECK_EQUAL(0, removed.size());
+        TEST_CHECK_EQUAL(1, watcher.GetNumberOfRegions());
+    }
+    std::remove(TEST_FILE_PATH);
+    return GetTestResult("WatchTest");
+}
+
+
+namespace {
+
+// Scans the memory as -watch does, carrying nothing over from previous scans
+void ScanAndUpdate(
+    __inout RawMemoryProvider& Memory,
+    __inout RegionWatcher& Watcher,
+    __out std::vector<RegionWatcher::Region>& Added,
+    __out std::vector<RegionWatcher::Region>& Removed)
+{
+    PageTableSnapshot pageTables;
+    NegativeReadCache unreadable(Memory);
+    ScanOptions options = {};
+    Scanner scanner(unreadable, pageTables, options);
+    const auto result = scanner.Scan();
+    TEST_CHECK(result.Statistics[2].Error.empty());
+    Watcher.Update(result, Added, Removed);
+}
+
+
+// Writes Data at Offset of the test file, creating it when it does not exist
+bool WriteTestFile(
+    __in ULONG64 Offset,
+    __in const void* Data,
+    __in SIZE_T Size)
+{
+    auto file = std::fopen(TEST_FILE_PATH, "r+b");
+    if (!file)
+    {
+        file = std::fopen(TEST_FILE_PATH, "wb");
+    }
+    if (!file)
+    {
+        return false;
+    }
+    const auto isWritten =
+        std::fseek(file, static_cast<long>(Offset), SEEK_SET) == 0 &&
+        std::fwrite(Data, 1, Size, file) == Size;
+    return std::fclose(file) == 0 && isWritten;
+}
+
+} // End of namespace {unnamed}
+
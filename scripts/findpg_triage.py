@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+#
+# Runs !findpg over many crash dumps with cdb, or findpgscan over many ELF
+# core files, and aggregates FINDPG_SUMMARY lines of their logs into a single
+# CSV file.
+#
+# Each dump is analyzed by its own process since the debugger engine hosts one
+# target per process. Dumps are started from the largest one so that the
+# longest analyses do not end up running alone at the end, and the number of
+# concurrent processes is capped as each of them may map a large dump. On
+# Linux, the address space of each process can also be limited so that a
+# single dump cannot exhaust memory of the machine.
+#
+#   > py findpg_triage.py C:\dumps -j 4 -o summary.csv -- -budget 600
+#   $ ./findpg_triage.py /cores -j 8 --memory-limit 4096 -- -budget 600
+#
+import argparse
+import csv
+import os
+import shutil
+import subprocess
+import sys
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+SUMMARY_PREFIX = 'FINDPG_SUMMARY'
+
+# Extensions of dumps searched in directories for each backend
+DUMP_EXTENSIONS = {
+    'cdb': ('.dmp',),
+    'findpgscan': ('.elf', '.core'),
+}
+
+# Fields of FINDPG_SUMMARY in the order they are written to the CSV file.
+# Fields added by later versions of findpg are appended after them.
+SUMMARY_FIELDS = [
+    'Timer', 'BigPagePool', 'Independent', 'Phase0Ms', 'Phase1Ms', 'Phase2Ms',
+    'Failures', 'Partial',
+]
+
+
+def find_dumps(paths, extensions):
+    """Returns dump files in the paths sorted by size in descending order."""
+    dumps = []
+    for path in paths:
+        if os.path.isdir(path):
+            for name in os.listdir(path):
+                if name.lower().endswith(extensions):
+                    dumps.append(os.path.join(path, name))
+        else:
+            dumps.append(path)
+    return sorted(set(dumps), key=os.path.getsize, reverse=True)
+
+
+def parse_summary(log):
+    """Returns fields of the last FINDPG_SUMMARY line in the log, or None."""
+    summary = None
+    try:
+        with open(log, encoding='utf-8', errors='replace') as f:
+            for line in f:
+                line = line.strip()
+                if line.startswith(SUMMARY_PREFIX):
+                    summary = dict(field.split('=', 1)
+                                   for field in line.split()[1:]
+                                   if '=' in field)
+    except OSError:
+        pass
+    return summary
+
+
+def get_log_names(dumps):
+    """Returns names of logs of the dumps, which are unique among them."""
+    names = {}
+    used = set()
+    for dump in dumps:
+        base = os.path.splitext(os.path.basename(dump))[0]
+        name = base + '.log'
+        suffix = 1
+        while name.lower() in used:
+            suffix += 1
+            name = '{}_{}.log'.format(base, suffix)
+        used.add(name.lower())
+        names[dump] = name
+    return names
+
+
+def limit_memory(limit_bytes):
+    """Returns a function limiting the address space of a child process."""
+    def set_limit():
+        import resource
+        resource.setrlimit(resource.RLIMIT_AS, (limit_bytes, limit_bytes))
+    return set_limit
+
+
+def analyze(dump, log, args):
+    """Runs the backend for the dump and returns its summary and exit code."""
+    preexec_fn = None
+    if args.memory_limit:
+        preexec_fn = limit_memory(args.memory_limit * 1024 * 1024)
+    if args.backend == 'cdb':
+        command = ' '.join(['!findpg'] + args.findpg_args)
+        process = subprocess.run(
+            [args.cdb, '-z', dump, '-logo', log,
+             '-c', '.load {};{};q'.format(args.extension, command)],
+            stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL)
+    else:
+        with open(log, 'w') as f:
+            process = subprocess.run(
+                [args.findpgscan, '-elfcore', dump] + args.findpg_args,
+                stdin=subprocess.DEVNULL, stdout=f, stderr=subprocess.STDOUT,
+                preexec_fn=preexec_fn)
+    return parse_summary(log), process.returncode
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Runs !findpg over crash dumps with cdb, or findpgscan '
+                    'over ELF core files, and aggregates FINDPG_SUMMARY '
+                    'lines.')
+    parser.add_argument('paths', nargs='+',
+                        help='dump files or directories containing *.dmp '
+                             '(cdb) or *.elf and *.core (findpgscan)')
+    parser.add_argument('--backend', choices=sorted(DUMP_EXTENSIONS),
+                        default='cdb' if os.name == 'nt' else 'findpgscan',
+                        help='the program analyzing each dump '
+                             '(default: %(default)s)')
+    parser.add_argument('-j', '--jobs', type=int,
+                        default=min(4, os.cpu_count() or 1),
+                        help='the maximum number of concurrent processes '
+                             '(default: %(default)s)')
+    parser.add_argument('-o', '--output', default='findpg_summary.csv',
+                        help='the CSV file to write (default: %(default)s)')
+    parser.add_argument('--log-dir', default='.',
+                        help='the directory to write logs of each dump')
+    parser.add_argument('--cdb', default='cdb', help='the path to cdb.exe')
+    parser.add_argument('--extension', default='findpg',
+                        help='the name or path of the extension to load')
+    parser.add_argument('--findpgscan', default='findpgscan',
+                        help='the path to findpgscan')
+    parser.add_argument('--memory-limit', type=int, metavar='MB',
+                        help='the maximum address space of each findpgscan '
+                             'process in MB (POSIX only)')
+    parser.epilog = ('Arguments after "--" are passed to !findpg or '
+                     'findpgscan.')
+
+    # Arguments of !findpg are split first as they may look like options
+    argv = sys.argv[1:]
+    findpg_args = []
+    if '--' in argv:
+        findpg_args = argv[argv.index('--') + 1:]
+        argv = argv[:argv.index('--')]
+    args = parser.parse_args(argv)
+    args.findpg_args = findpg_args
+    if args.jobs < 1:
+        parser.error('--jobs must be one or more')
+    if args.memory_limit is not None:
+        if args.memory_limit < 1:
+            parser.error('--memory-limit must be one or more')
+        if args.backend != 'findpgscan' or os.name != 'posix':
+            parser.error('--memory-limit is only supported with findpgscan '
+                         'on POSIX')
+    program = args.cdb if args.backend == 'cdb' else args.findpgscan
+    if not shutil.which(program):
+        parser.error('{} is not found'.format(program))
+
+    dumps = find_dumps(args.paths, DUMP_EXTENSIONS[args.backend])
+    if not dumps:
+        parser.error('no dump file is found')
+    os.makedirs(args.log_dir, exist_ok=True)
+
+    logs = get_log_names(dumps)
+    results = {}
+    with ThreadPoolExecutor(max_workers=args.jobs) as executor:
+        futures = {executor.submit(analyze, dump,
+                                   os.path.join(args.log_dir, logs[dump]),
+                                   args): dump
+                   for dump in dumps}
+        for future in as_completed(futures):
+            dump = futures[future]
+            summary, exit_code = future.result()
+            results[dump] = (summary, exit_code)
+            print('[{}/{}] {}: {}'.format(
+                len(results), len(dumps), os.path.basename(dump),
+                'done' if summary else
+                'no summary (exit code {})'.format(exit_code)))
+
+    # Write rows in the order dumps were started
+    extra_fields = sorted({key for summary, _ in results.values() if summary
+                           for key in summary} - set(SUMMARY_FIELDS))
+    fields = SUMMARY_FIELDS + extra_fields
+    totals = dict.fromkeys(['Timer', 'BigPagePool', 'Independent'], 0)
+    number_of_failed_dumps = 0
+    with open(args.output, 'w', newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(['Dump', 'Status'] + fields)
+        for dump in dumps:
+            summary, exit_code = results[dump]
+            if not summary:
+                number_of_failed_dumps += 1
+                writer.writerow([dump, 'NoSummary'] + [''] * len(fields))
+                continue
+            for key in totals:
+                totals[key] += int(summary.get(key, 0))
+            writer.writerow([dump, 'OK'] + [summary.get(key, '')
+                                            for key in fields])
+
+    print('{} dumps analyzed, {} without a summary. Found: {}. Written to {}'
+          .format(len(dumps), number_of_failed_dumps,
+                  ', '.join('{}={}'.format(key, value)
+                            for key, value in totals.items()),
+                  args.output))
+    return 1 if number_of_failed_dumps else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())